@@ -2,105 +2,198 @@
 
 template <typename T>
 void Setup<T>::addObstacle(const std::vector<Point<T>>& obstacle) {
-    if (obstacle.size() != 4) {
-        logger->error("Error: Obstacle must be defined by 4 corners.");
+    if (obstacle.size() < 3) {
+        logger->error("Error: Obstacle must be a polygon with at least 3 corners.");
         return;
     }
+    ObstacleBatch batch;
+    batch.addPolygon(obstacle);
+    ObstacleRasterizer::Result result = rasterize(batch, 1);
+    logger->info("Obstacle added covering cells ({}, {}) to ({}, {})", result.x0, result.y0, result.x1, result.y1);
+}
+
+template <typename T>
+typename ObstacleRasterizer::Result Setup<T>::addObstacles(const ObstacleBatch& batch, int threads) {
+    ObstacleRasterizer::Result result = rasterize(batch, threads);
+    logger->info("Ingested {} obstacles ({} new cells) in {:.3f} ms: {:.0f} obstacles/s", result.obstacles, result.cellsMarked,
+                 result.seconds * 1e3, result.seconds > 0 ? result.obstacles / result.seconds : 0.0);
+    return result;
+}
 
-    // Assume the obstacle is defined by 4 corners: top-left, top-right, bottom-right, bottom-left
-    Point<T> topLeft = obstacle[0];
-    Point<T> topRight = obstacle[1];
-    Point<T> bottomRight = obstacle[2];
-    Point<T> bottomLeft = obstacle[3];
+template <typename T>
+typename ObstacleRasterizer::Result Setup<T>::removeObstacles(const ObstacleBatch& batch, int threads) {
+    ObstacleRasterizer::Result result = rasterize(batch, threads, true);
+    logger->info("Removed {} obstacles ({} cells freed) in {:.3f} ms", result.obstacles, result.cellsMarked, result.seconds * 1e3);
+    return result;
+}
 
-    // Get the min and max X and Y values from the corners
-    T minX = std::min({topLeft.getX(), topRight.getX(), bottomRight.getX(), bottomLeft.getX()});
-    T maxX = std::max({topLeft.getX(), topRight.getX(), bottomRight.getX(), bottomLeft.getX()});
-    T minY = std::min({topLeft.getY(), topRight.getY(), bottomRight.getY(), bottomLeft.getY()});
-    T maxY = std::max({topLeft.getY(), topRight.getY(), bottomRight.getY(), bottomLeft.getY()});
+template <typename T>
+typename ObstacleRasterizer::Result Setup<T>::rasterize(const ObstacleBatch& batch, int threads, bool clear) {
+    ObstacleRasterizer::Result result = ObstacleRasterizer(batch, arena, dim, clear).run(threads);
+    if (result.x1 >= result.x0) clearance.markChanged(result.x0, result.y0, result.x1, result.y1);
+    return result;
+}
+
+template <typename T>
+void Setup<T>::addBox(const Point<T>& corner, const Point<T>& opposite) {
+    if (!volume) {
+        logger->error("Error: addBox needs a 3D arena.");
+        return;
+    }
+    int x0 = static_cast<int>(std::min(corner.getX(), opposite.getX()) / dim);
+    int y0 = static_cast<int>(std::min(corner.getY(), opposite.getY()) / dim);
+    int z0 = static_cast<int>(std::min(corner.getZ(), opposite.getZ()) / dim);
+    int x1 = static_cast<int>(std::max(corner.getX(), opposite.getX()) / dim);
+    int y1 = static_cast<int>(std::max(corner.getY(), opposite.getY()) / dim);
+    int z1 = static_cast<int>(std::max(corner.getZ(), opposite.getZ()) / dim);
+    volume->setBox(x0, y0, z0, x1, y1, z1);
 
-    // Iterate over all points in the rectangular region and mark them as obstacles
-    for (T x = minX; x <= maxX; x += dim) {
-        for (T y = minY; y <= maxY; y += dim) {
-            Point<T> point(x, y);
-            markCell(point, -1); // Mark the cell as an obstacle (-1)
+    // Floor projection, for visualize()
+    for (int y = std::max(y0, 0); y <= std::min(y1, arena.rows() - 1); ++y) {
+        for (int x = std::max(x0, 0); x <= std::min(x1, arena.cols() - 1); ++x) {
+            arena.setObstacle(x, y, true);
         }
     }
-    logger->info("Obstacle added with top-left: ({}, {}), bottom-right: ({}, {})", minX, minY, maxX, maxY);
+    logger->info("Box added from ({}, {}, {}) to ({}, {}, {}); {} voxels in {} bricks", corner.getX(), corner.getY(), corner.getZ(),
+                 opposite.getX(), opposite.getY(), opposite.getZ(), volume->occupiedVoxels(), volume->brickCount());
 }
+
 template <typename T>
-Node<T>* RRTPlanner<T>::findNearest(const Point<T>& randomPoint, Node<T>* currentNode, double& minDistance) {
-        Node<T>* nearestNode = nullptr;
-        std::queue<Node<T>*> queue;
-        queue.push(currentNode);
+bool Setup<T>::saveMap(const std::string& path) const {
+    TiledMapWriter writer(path, arena.cols(), arena.rows(), dim);
+    std::vector<std::uint8_t> row(arena.cols());
+    for (int y = 0; y < arena.rows() && writer.good(); ++y) {
+        for (int x = 0; x < arena.cols(); ++x) {
+            row[x] = arena.isObstacle(x, y);
+        }
+        writer.addRow(row.data());
+    }
+    if (!writer.finish()) {
+        logger->error("Could not write map file {}", path);
+        return false;
+    }
+    logger->info("Saved {}x{} arena to {}", arena.cols(), arena.rows(), path);
+    return true;
+}
 
-        while (!queue.empty()) {
-            Node<T>* node = queue.front();
-            queue.pop();
+template <typename T>
+void RRTPlanner<T>::setNearestIndex(std::unique_ptr<Index> newIndex) {
+    std::unique_lock<std::mutex> lock(treeMutex);
+    for (NodeId id = 0; id < tree.size(); ++id) {
+        if (attached(tree, id)) newIndex->insert(tree.point(id), id);
+    }
+    index = std::move(newIndex);
+}
 
-            double distance = calculateDistance(node->getPoint(), randomPoint);
-            if (distance < minDistance) {
-                minDistance = distance;
-                nearestNode = node;
-            }
+template <typename T>
+void RRTPlanner<T>::setMode(PlannerMode newMode) {
+    mode = newMode;
+    if (mode == PlannerMode::Connect && goalTree.empty()) {
+        goalIndex = makeIndex();
+        NodeId root = goalTree.add(setup.target, kNoNode);
+        goalIndex->insert(setup.target, root);
+        count.fetch_add(1, std::memory_order_relaxed);
+    }
+}
 
-            for (const auto& child : node->getChildren()) {
-                queue.push(child.get());
-            }
-        }
-        return nearestNode;
+template <typename T>
+NodeId RRTPlanner<T>::nearestIn(const Index& idx, const Point<T>& point, double& minDistance) {
+    PhaseTimer timer(Phase::Nearest);
+    NodeId nearestNode = kNoNode;
+    if (idx.concurrentReads()) {
+        idx.nearest(point, nearestNode, minDistance);
+    } else {
+        auto lock = lockTree();
+        idx.nearest(point, nearestNode, minDistance);
     }
+    return nearestNode;
+}
+
 template <typename T>
-Point<T> RRTPlanner<T>::samplePoint() {
-    Point<T> point = Point<T>(distX(gen), distY(gen));
-    logger->debug("Sampled Point: ({}, {})", point.getX(), point.getY());
+NodeId RRTPlanner<T>::findNearest(const Point<T>& randomPoint, double& minDistance) {
+    return nearestIn(*index, randomPoint, minDistance);
+}
+
+template <typename T>
+std::vector<NodeId> RRTPlanner<T>::findNear(const Point<T>& point, double radius) {
+    std::vector<NodeId> nodes;
+    if (index->concurrentReads()) {
+        index->radius(point, radius, nodes);
+    } else {
+        auto lock = lockTree();
+        index->radius(point, radius, nodes);
+    }
+    return nodes;
+}
+
+template <typename T>
+Point<T> RRTPlanner<T>::samplePoint(Stream& stream) {
+    PhaseTimer timer(Phase::Sample);
+    Point<T> point = sampler->next(stream);
+    SPDLOG_LOGGER_TRACE(logger, "Sampled Point: ({}, {})", point.getX(), point.getY());
     return point;
 }
 
 
 template <typename T>
-  void RRTPlanner<T>::addNode(Node<T>* nearestNode, const Point<T>& newPoint) {
-        std::unique_lock<std::mutex> lock(treeMutex);
-        nearestNode->addChild(std::make_unique<Node<T>>(newPoint, nearestNode));
-        setup.markCell(newPoint, 1);
+NodeId RRTPlanner<T>::addNode(NodeId nearestNode, const Point<T>& newPoint) {
+    return addTo(tree, *index, nearestNode, newPoint);
+}
+
+template <typename T>
+NodeId RRTPlanner<T>::addTo(TreeStore<T>& store, Index& idx, NodeId parent, const Point<T>& newPoint) {
+    auto lock = lockTree();
+    return addLocked(store, idx, parent, newPoint);
+}
+
+template <typename T>
+NodeId RRTPlanner<T>::addLocked(TreeStore<T>& store, Index& idx, NodeId parent, const Point<T>& newPoint) {
+    double cost = parent != kNoNode ? store.cost(parent) + calculateDistance(store.point(parent), newPoint) : 0;
+    NodeId newNode = store.add(newPoint, parent, cost);
+    if (newNode == kNoNode) {
+        return kNoNode;
     }
+    idx.insert(newPoint, newNode);
+    count.fetch_add(1, std::memory_order_relaxed);
+    nodeAdded(store, newNode);
+    return newNode;
+}
 template <typename T>
-bool RRTPlanner<T>::collision_avoidance_check(Point<T>& randomPoint, const Point<T>& nearestPoint) {
+bool RRTPlanner<T>::steer(Point<T>& randomPoint, const Point<T>& nearestPoint) const {
     double dx = randomPoint.getX() - nearestPoint.getX();
     double dy = randomPoint.getY() - nearestPoint.getY();
-    double distance = std::sqrt(dx * dx + dy * dy);
-
-    logger->debug("Checking collision from ({}, {}) to ({}, {})", nearestPoint.getX(), nearestPoint.getY(), randomPoint.getX(), randomPoint.getY());
+    double dz = randomPoint.getZ() - nearestPoint.getZ();
+    double distance = std::sqrt(dx * dx + dy * dy + dz * dz);
 
     if (distance == 0) {
         return false;
     }
 
     // Calculate the step ratio to limit the distance to step_size
-    double step_ratio = std::min(setup.step_size / distance, 1.0);
+    double step_ratio = std::min(stepSize / distance, 1.0);
 
     // Modify the random point to reflect the maximum step_size distance
-    randomPoint.modify_x(nearestPoint.getX() + step_ratio * dx);
-    randomPoint.modify_y(nearestPoint.getY() + step_ratio * dy);
+    randomPoint.modify_x(toCoordinate(nearestPoint.getX() + step_ratio * dx));
+    randomPoint.modify_y(toCoordinate(nearestPoint.getY() + step_ratio * dy));
+    randomPoint.modify_z(toCoordinate(nearestPoint.getZ() + step_ratio * dz));
 
-    logger->debug("Modified random point to: ({}, {})", randomPoint.getX(), randomPoint.getY());
+    SPDLOG_LOGGER_TRACE(logger, "Modified random point to: ({}, {})", randomPoint.getX(), randomPoint.getY());
+    return true;
+}
 
-    // Now check the path from nearestPoint to randomPoint in steps of 'dim'
-    int steps = static_cast<int>(distance / setup.dim);
-    double step_dx = dx / steps;
-    double step_dy = dy / steps;
+template <typename T>
+bool RRTPlanner<T>::collision_avoidance_check(Point<T>& randomPoint, const Point<T>& nearestPoint) {
+    PhaseTimer timer(Phase::Collision);
+    SPDLOG_LOGGER_TRACE(logger, "Checking collision from ({}, {}) to ({}, {})", nearestPoint.getX(), nearestPoint.getY(), randomPoint.getX(), randomPoint.getY());
 
-    for (int i = 1; i <= steps; i++) {
-        double intermediate_x = nearestPoint.getX() + i * step_dx;
-        double intermediate_y = nearestPoint.getY() + i * step_dy;
-        if(abs(intermediate_x -nearestPoint.getX()) < setup.dim && abs(intermediate_y -nearestPoint.getY()) < setup.dim)
-        {
-            continue;
-        }
-        if (!setup.isValid(Point<T>(intermediate_x, intermediate_y))) {
-            logger->warn("Path blocked at: ({}, {})", intermediate_x, intermediate_y);
-            return false; // Obstacle detected
-        }
+    if (!steer(randomPoint, nearestPoint)) {
+        return false;
+    }
+
+    // Walk every grid cell (voxel in 3D) the steered segment crosses, inflated by the robot footprint
+    if (!edgeFree(nearestPoint, randomPoint)) {
+        SPDLOG_LOGGER_TRACE(logger, "Path blocked between: ({}, {}) and ({}, {})", nearestPoint.getX(), nearestPoint.getY(), randomPoint.getX(), randomPoint.getY());
+        return false; // Obstacle detected
     }
 
     return true; // Path is clear
@@ -111,60 +204,476 @@ template <typename T>
 void RRTPlanner<T>::run(int thread_id) {
     logger->debug("Thread {} started running.", thread_id);
 
+    // Independent random stream per thread
+    std::seed_seq seq{seed, static_cast<unsigned>(thread_id)};
+    Stream stream(seq);
+    PlannerStats local;
+    PhaseMetrics localMetrics;
+    threadMetrics = &localMetrics;
 
-    while (!targetReached) {
-        Point<T> randomPoint = samplePoint();
+    if (mode == PlannerMode::Connect) {
+        runConnect(thread_id, stream, local);
+        retire(stream, local, localMetrics);
+        return;
+    }
+    if (mode == PlannerMode::Star) {
+        runStar(thread_id, stream, local);
+        retire(stream, local, localMetrics);
+        return;
+    }
+    if (mode == PlannerMode::Lazy) {
+        runLazy(thread_id, stream, local);
+        retire(stream, local, localMetrics);
+        return;
+    }
+
+    while (!targetReached.load(std::memory_order_relaxed)) {
+        Point<T> randomPoint = samplePoint(stream);
+        ++local.samples;
         double minDistance = std::numeric_limits<double>::max();
 
         // Find the nearest point in the tree
-        std::unique_lock<std::mutex> lock(treeMutex);
-        Node<T>* nearestNode = findNearest(randomPoint, root.get(), minDistance);
-        lock.unlock();
-        if (nearestNode != nullptr) 
+        NodeId nearestNode = findNearest(randomPoint, minDistance);
+        Point<T> nearestPoint = nearestNode != kNoNode ? tree.point(nearestNode) : Point<T>();
+        if (nearestNode != kNoNode) 
         {
-        logger->debug("Thread {}: Nearest Node found at ({}, {})", thread_id, nearestNode->getPoint().getX(), nearestNode->getPoint().getY());
+        SPDLOG_LOGGER_TRACE(logger, "Thread {}: Nearest Node found at ({}, {})", thread_id, nearestPoint.getX(), nearestPoint.getY());
         } 
         else 
         {
-         logger->debug("Thread {}: Nearest Node is nullptr.", thread_id);
+         SPDLOG_LOGGER_TRACE(logger, "Thread {}: Nearest Node is kNoNode.", thread_id);
         }
-        if (nearestNode && abs(nearestNode->getPoint().getX() - randomPoint.getX()) > setup.dim && abs(nearestNode->getPoint().getY() - randomPoint.getY()) > setup.dim) {  
+        // Samples within one cell of their nearest node add nothing; testing each axis separately
+        // instead would reject every sample that lines up with a node, and could starve the goal
+        if (nearestNode != kNoNode && squaredDistance(nearestPoint, randomPoint) > static_cast<double>(setup.dim) * setup.dim) {
             // Adjust randomPoint to a point within step_size distance and check if the path is clear
-            if (collision_avoidance_check(randomPoint, nearestNode->getPoint())) {
-                logger->debug("Thread {}: Path is clear.", thread_id);
-                std::unique_lock<std::mutex> lock(treeMutex);
-                nearestNode->addChild(std::make_unique<Node<T>>(randomPoint, nearestNode));
-                setup.markCell(randomPoint, 1);
-                logger->info("Thread {}: Added point {} at ({}, {})", thread_id, count++, randomPoint.getX(), randomPoint.getY());
-                lock.unlock();
-
-                // Check if the target has been reached
-                if (calculateDistance(randomPoint, setup.target) < setup.dim*1.5) {
+            if (collision_avoidance_check(randomPoint, nearestPoint)) {
+                SPDLOG_LOGGER_TRACE(logger, "Thread {}: Path is clear.", thread_id);
+                NodeId newNode = addNode(nearestNode, randomPoint);
+                if (newNode == kNoNode) {
+                    logger->error("Thread {}: Node storage exhausted, stopping.", thread_id);
+                    std::unique_lock<std::mutex> lock(treeMutex);
+                    targetReached = true;
+                    cv.notify_all();
+                    break;
+                }
+                SPDLOG_LOGGER_DEBUG(logger, "Thread {}: Added point {} at ({}, {})", thread_id, count.load(), randomPoint.getX(), randomPoint.getY());
+                sampler->accept(stream);
+                ++local.added;
+
+                // Check if the target has been reached (planStops() tracks its stops in nodeAdded)
+                if (stops.empty() && nearTarget(randomPoint)) {
                     logger->info("Thread {}: Target reached!", thread_id);
                     std::unique_lock<std::mutex> lock(treeMutex);
+                    if (goalNode == kNoNode) {
+                        goalNode = newNode;
+                        bestCost = tree.cost(newNode);
+                        recordFirstPath();
+                    }
                     targetReached = true;
                     cv.notify_all();
                     logger->info("Thread {}: Notified all threads", thread_id);
                     lock.unlock();
                 }
+            } else {
+                sampler->reject(stream);
+                ++local.blocked;
             }
         }
-        else if(nearestNode)
+        else if(nearestNode != kNoNode)
         {
-            logger->debug("Thread {}: Random point too close to nearest node.", thread_id);
+            SPDLOG_LOGGER_TRACE(logger, "Thread {}: Random point too close to nearest node.", thread_id);
+            sampler->reject(stream);
+            ++local.tooClose;
         }
         else
         {
-            logger->warn("Thread {}: Nearest node is nullptr.", thread_id);
+            logger->warn("Thread {}: Nearest node is kNoNode.", thread_id);
         }
     }
+    retire(stream, local, localMetrics);
 }
 
+template <typename T>
+void RRTPlanner<T>::retire(Stream& stream, const PlannerStats& local, const PhaseMetrics& localMetrics) {
+    threadMetrics = nullptr;
+    sampler->flush(stream);
+    std::unique_lock<std::mutex> lock(treeMutex);
+    stats += local;
+    metrics += localMetrics;
+}
+
+
+
+template <typename T>
+bool RRTPlanner<T>::connect(TreeStore<T>& store, Index& idx, const Point<T>& point, NodeId& reached, PlannerStats& local) {
+    while (!targetReached.load(std::memory_order_relaxed)) {
+        double minDistance = std::numeric_limits<double>::max();
+        NodeId nearestNode = nearestIn(idx, point, minDistance);
+        if (nearestNode == kNoNode) {
+            return false;
+        }
+        if (minDistance == 0) {
+            reached = nearestNode;
+            return true;
+        }
+
+        Point<T> nearestPoint = store.point(nearestNode);
+        Point<T> stepPoint = point;
+        if (!collision_avoidance_check(stepPoint, nearestPoint) || stepPoint == nearestPoint) {
+            ++local.blocked;
+            return false;
+        }
+        NodeId newNode = addTo(store, idx, nearestNode, stepPoint);
+        if (newNode == kNoNode) {
+            return false;
+        }
+        ++local.added;
+        if (stepPoint == point) {
+            reached = newNode;
+            return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+void RRTPlanner<T>::runConnect(int thread_id, Stream& stream, PlannerStats& local) {
+    bool fromStart = thread_id % 2 == 0;
+
+    while (!targetReached.load(std::memory_order_relaxed)) {
+        TreeStore<T>& extendTree = fromStart ? tree : goalTree;
+        Index& extendIndex = fromStart ? *index : *goalIndex;
+        TreeStore<T>& otherTree = fromStart ? goalTree : tree;
+        Index& otherIndex = fromStart ? *goalIndex : *index;
+
+        Point<T> randomPoint = samplePoint(stream);
+        ++local.samples;
+        double minDistance = std::numeric_limits<double>::max();
+        NodeId nearestNode = nearestIn(extendIndex, randomPoint, minDistance);
+
+        if (nearestNode != kNoNode && collision_avoidance_check(randomPoint, extendTree.point(nearestNode))) {
+            NodeId newNode = addTo(extendTree, extendIndex, nearestNode, randomPoint);
+            if (newNode == kNoNode) {
+                logger->error("Thread {}: Node storage exhausted, stopping.", thread_id);
+                finish();
+                break;
+            }
+            SPDLOG_LOGGER_DEBUG(logger, "Thread {}: Added point {} at ({}, {})", thread_id, count.load(), randomPoint.getX(), randomPoint.getY());
+            sampler->accept(stream);
+            ++local.added;
+
+            // Pull the other tree towards the new node as far as it can go
+            NodeId reached = kNoNode;
+            if (connect(otherTree, otherIndex, randomPoint, reached, local)) {
+                logger->info("Thread {}: Trees connected at ({}, {})", thread_id, randomPoint.getX(), randomPoint.getY());
+                {
+                    std::unique_lock<std::mutex> lock(treeMutex);
+                    if (connectStart == kNoNode) {
+                        connectStart = fromStart ? newNode : reached;
+                        connectGoal = fromStart ? reached : newNode;
+                        bestCost = tree.cost(connectStart) + goalTree.cost(connectGoal);
+                        recordFirstPath();
+                    }
+                }
+                finish();
+            }
+        } else {
+            sampler->reject(stream);
+            ++local.blocked;
+        }
+        fromStart = !fromStart;
+    }
+}
+
+template <typename T>
+double RRTPlanner<T>::rewireRadius(std::size_t n) const {
+    double nodes = static_cast<double>(n + 1);
+    double radius;
+    if (setup.is3D()) {
+        // 3D bound 2 * (4/3)^(1/3) * (volume / unit-ball volume)^(1/3), radius shrinking as (log n / n)^(1/3)
+        double gamma = 2.0 * std::cbrt(4.0 / 3.0) * std::cbrt(static_cast<double>(setup.length) * setup.width * setup.height / (4.0 / 3.0 * M_PI));
+        radius = gamma * std::cbrt(std::log(nodes) / nodes);
+    } else {
+        // gamma just above the asymptotic-optimality bound 2 * sqrt(1.5 * area / pi) for 2D
+        double gamma = 2.0 * std::sqrt(1.5 * setup.length * setup.width / M_PI);
+        radius = gamma * std::sqrt(std::log(nodes) / nodes);
+    }
+    return std::min(radius, stepSize);
+}
+
+template <typename T>
+void RRTPlanner<T>::propagateCost(NodeId root, double delta) {
+    rewireStack.clear();
+    tree.forEachChild(root, [this](NodeId c) { rewireStack.push_back(c); });
+    while (!rewireStack.empty()) {
+        NodeId id = rewireStack.back();
+        rewireStack.pop_back();
+        tree.setCost(id, tree.cost(id) + delta);
+        tree.forEachChild(id, [this](NodeId c) { rewireStack.push_back(c); });
+    }
+}
+
+template <typename T>
+NodeId RRTPlanner<T>::addStar(NodeId nearestNode, const Point<T>& newPoint, PlannerStats& local) {
+    auto lock = lockTree();
+    std::vector<NodeId> near;
+    index->radius(newPoint, rewireRadius(tree.size()), near);
+
+    // The edge from nearestNode was already checked; any other parent needs its own check
+    NodeId parent = nearestNode;
+    double newCost = tree.cost(nearestNode) + calculateDistance(tree.point(nearestNode), newPoint);
+    for (NodeId n : near) {
+        Point<T> p = tree.point(n);
+        double cost = tree.cost(n) + calculateDistance(p, newPoint);
+        if (cost < newCost && edgeFree(p, newPoint)) {
+            parent = n;
+            newCost = cost;
+        }
+    }
+
+    NodeId newNode = tree.add(newPoint, parent, newCost);
+    if (newNode == kNoNode) {
+        return kNoNode;
+    }
+    index->insert(newPoint, newNode);
+    count.fetch_add(1, std::memory_order_relaxed);
+    nodeAdded(tree, newNode);
+
+    // Ancestors of the new node are always cheaper than it, so rewiring cannot create a cycle
+    for (NodeId n : near) {
+        if (n == parent) continue;
+        Point<T> p = tree.point(n);
+        double cost = newCost + calculateDistance(newPoint, p);
+        if (cost < tree.cost(n) && edgeFree(newPoint, p)) {
+            double delta = cost - tree.cost(n);
+            tree.setParent(n, newNode);
+            tree.setCost(n, cost);
+            propagateCost(n, delta);
+            ++local.rewired;
+        }
+    }
+
+    if (nearTarget(newPoint)) {
+        goalCandidates.push_back(newNode);
+    }
+    // Rewiring may have lowered any candidate's cost, not just the new node's
+    for (NodeId g : goalCandidates) {
+        if (tree.cost(g) < bestCost.load(std::memory_order_relaxed)) {
+            bestCost = tree.cost(g);
+            goalNode = g;
+            sampler->pathCostImproved(tree.cost(g));
+            recordFirstPath();
+            SPDLOG_LOGGER_DEBUG(logger, "Best path cost improved to {} after {} nodes", tree.cost(g), tree.size());
+        }
+    }
+    return newNode;
+}
+
+template <typename T>
+bool RRTPlanner<T>::budgetSpent() const {
+    if (timeBudget.count() == 0 && iterationBudget == 0 && nodeBudget == 0) {
+        return bestCost.load() < std::numeric_limits<double>::infinity();
+    }
+    if (iterationBudget != 0 && iterations.load(std::memory_order_relaxed) >= iterationBudget) {
+        return true;
+    }
+    if (nodeBudget != 0 && static_cast<std::size_t>(count.load(std::memory_order_relaxed)) >= nodeBudget) {
+        return true;
+    }
+    return timeBudget.count() != 0 && std::chrono::steady_clock::now() - startTime >= timeBudget;
+}
+
+template <typename T>
+void RRTPlanner<T>::runStar(int thread_id, Stream& stream, PlannerStats& local) {
+    while (!targetReached.load(std::memory_order_relaxed)) {
+        Point<T> randomPoint = samplePoint(stream);
+        ++local.samples;
+        double minDistance = std::numeric_limits<double>::max();
+        NodeId nearestNode = findNearest(randomPoint, minDistance);
+
+        Point<T> nearestPoint = nearestNode != kNoNode ? tree.point(nearestNode) : Point<T>();
+        if (nearestNode != kNoNode && collision_avoidance_check(randomPoint, nearestPoint) && !(randomPoint == nearestPoint)) {
+            if (addStar(nearestNode, randomPoint, local) == kNoNode) {
+                logger->error("Thread {}: Node storage exhausted, stopping.", thread_id);
+                finish();
+                break;
+            }
+            SPDLOG_LOGGER_DEBUG(logger, "Thread {}: Added point {} at ({}, {})", thread_id, count.load(), randomPoint.getX(), randomPoint.getY());
+            sampler->accept(stream);
+            ++local.added;
+        } else {
+            sampler->reject(stream);
+            ++local.blocked;
+        }
+
+        iterations.fetch_add(1, std::memory_order_relaxed);
+        if (budgetSpent()) {
+            logger->info("Thread {}: Budget spent, best cost {}", thread_id, bestCost.load());
+            finish();
+        }
+    }
+}
+
+template <typename T>
+void RRTPlanner<T>::runLazy(int thread_id, Stream& stream, PlannerStats& local) {
+    double minSpacing2 = static_cast<double>(setup.dim) * setup.dim;
+    while (!targetReached.load(std::memory_order_relaxed)) {
+        Point<T> randomPoint = samplePoint(stream);
+        ++local.samples;
+        double minDistance = std::numeric_limits<double>::max();
+        NodeId nearestNode = findNearest(randomPoint, minDistance);
+        if (nearestNode == kNoNode) {
+            logger->warn("Thread {}: Nearest node is kNoNode.", thread_id);
+            continue;
+        }
+        Point<T> nearestPoint = tree.point(nearestNode);
+        if (squaredDistance(nearestPoint, randomPoint) <= minSpacing2) {
+            sampler->reject(stream);
+            ++local.tooClose;
+            continue;
+        }
+        // The edge itself waits until a path needs it
+        if (!steer(randomPoint, nearestPoint) || !pointFree(randomPoint)) {
+            sampler->reject(stream);
+            ++local.blocked;
+            continue;
+        }
+
+        auto lock = lockTree();
+        // A validation on another thread may have dropped the nearest node since the query
+        if (!attached(tree, nearestNode)) {
+            lock.unlock();
+            sampler->reject(stream);
+            ++local.blocked;
+            continue;
+        }
+        NodeId newNode = addLocked(tree, *index, nearestNode, randomPoint);
+        if (newNode == kNoNode) {
+            logger->error("Thread {}: Node storage exhausted, stopping.", thread_id);
+            targetReached = true;
+            cv.notify_all();
+            break;
+        }
+        sampler->accept(stream);
+        ++local.added;
+        if (nearTarget(randomPoint) && validatePath(newNode, lock, local)) {
+            logger->info("Thread {}: Target reached, path validated", thread_id);
+            if (goalNode == kNoNode) {
+                goalNode = newNode;
+                bestCost = tree.cost(newNode);
+                recordFirstPath();
+            }
+            targetReached = true;
+            cv.notify_all();
+        }
+    }
+}
+
+template <typename T>
+bool RRTPlanner<T>::validatePath(NodeId goal, std::unique_lock<std::mutex>& lock, PlannerStats& local) {
+    struct Edge {
+        NodeId parent, child;
+        Point<T> from, to;
+        int state;    // 1 free, 0 blocked, -1 not checked yet
+    };
+    std::vector<Edge> path;
+    for (;;) {
+        if (!attached(tree, goal)) return false;
+        // Copy the path's edges from the root down, with what the cache knows of them
+        path.clear();
+        for (NodeId id = goal; id != 0; id = tree.parent(id)) {
+            NodeId parent = tree.parent(id);
+            auto cached = edgeValidity.find(edgeKey(parent, id));
+            path.push_back({parent, id, tree.point(parent), tree.point(id), cached != edgeValidity.end() ? int(cached->second) : -1});
+        }
+        std::reverse(path.begin(), path.end());
+
+        // Check the unknown edges without the lock, down to the first blocked one: a repair near
+        // the root changes everything below it
+        lock.unlock();
+        for (Edge& edge : path) {
+            if (edge.state == -1) {
+                PhaseTimer timer(Phase::Collision);
+                edge.state = edgeFree(edge.from, edge.to) ? 1 : 0;
+                ++local.validated;
+            }
+            if (edge.state == 0) break;
+        }
+        lock = lockTree();
+
+        // Other threads may have repaired the path meanwhile; outcomes only apply to edges whose
+        // child still hangs from the same parent (the root end of the path never moves)
+        bool current = true;
+        for (const Edge& edge : path) current = current && tree.parent(edge.child) == edge.parent;
+        for (const Edge& edge : path) {
+            if (edge.state == -1) break;
+            edgeValidity.emplace(edgeKey(edge.parent, edge.child), edge.state == 1);
+            if (edge.state == 0) {
+                if (current) {
+                    ++local.invalidated;
+                    repairLazyEdge(edge.child, local);
+                }
+                break;
+            }
+        }
+        if (current && (path.empty() || path.back().state == 1)) return true;
+    }
+}
 
+template <typename T>
+void RRTPlanner<T>::repairLazyEdge(NodeId child, PlannerStats& local) {
+    std::vector<NodeId> pending{child}, near;
+    while (!pending.empty()) {
+        NodeId c = pending.back();
+        pending.pop_back();
+        Point<T> p = tree.point(c);
+        near.clear();
+        index->radius(p, maxEdgeLength(), near);
+        NodeId best = kNoNode;
+        double bestCost = std::numeric_limits<double>::infinity();
+        for (NodeId n : near) {
+            auto cached = edgeValidity.find(edgeKey(n, c));
+            if (n == c || (cached != edgeValidity.end() && !cached->second)) continue;
+            double cost = tree.cost(n) + calculateDistance(tree.point(n), p);
+            if (cost >= bestCost) continue;
+            // Only nodes still hanging from the root: not below 'c', nor below a node dropped here
+            NodeId a = n;
+            while (a != 0 && a != c && a != kNoNode) a = tree.parent(a);
+            if (a == 0) {
+                best = n;
+                bestCost = cost;
+            }
+        }
+        if (best != kNoNode) {
+            double delta = bestCost - tree.cost(c);
+            tree.setParent(c, best);
+            tree.setCost(c, bestCost);
+            propagateCost(c, delta);
+            ++local.rewired;
+            continue;
+        }
+        // No parent left for 'c': it leaves the tree and the index, and its children look for
+        // parents of their own rather than going down with it
+        tree.forEachChild(c, [&pending](NodeId k) { pending.push_back(k); });
+        tree.setParent(c, kNoNode);
+        tree.setCost(c, std::numeric_limits<double>::infinity());
+        index->remove(p, c);
+        count.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
 
 template <typename T>
 void RRTPlanner<T>::start(int num_threads) {
+    runWorkers(num_threads, [this](std::unique_lock<std::mutex>& lock) {
+        cv.wait(lock, [this] { return targetReached.load(); });
+    });
+}
+
+template <typename T>
+void RRTPlanner<T>::runWorkers(int num_threads, const std::function<void(std::unique_lock<std::mutex>&)>& wait, bool resume) {
     std::vector<std::thread> threads;
+    if (!resume) startTime = std::chrono::steady_clock::now();
 
     // Launch multiple threads
     for (int i = 0; i < num_threads; ++i) {
@@ -172,51 +681,478 @@ void RRTPlanner<T>::start(int num_threads) {
     }
 
     std::unique_lock<std::mutex> lock(treeMutex);
-    cv.wait(lock, [this] { return targetReached; });
+    wait(lock);
     lock.unlock();
 
     // Join all threads once the target is reached
     for (auto& thread : threads) {
         thread.join();
     }
+
+    logger->info("Run summary: {} samples, {} nodes added, {} blocked, {} too close, {} rewired; {} sampler acceptance {:.3f}",
+                 stats.samples, stats.added, stats.blocked, stats.tooClose, stats.rewired,
+                 sampler->name(), sampler->acceptanceRatio());
+    if (mode == PlannerMode::Lazy) {
+        logger->info("Lazy edges: {} checked along candidate paths, {} blocked", stats.validated, stats.invalidated);
+    }
+    for (Phase phase : {Phase::Sample, Phase::Nearest, Phase::Collision, Phase::LockWait}) {
+        logger->info("Phase {}: {} calls, {:.3f} ms total", phaseName(phase), metrics[phase].count(), metrics[phase].sumSeconds() * 1e3);
+    }
+    logger->info("Time to first path: {:.3f} ms", getTimeToFirstPath() * 1e3);
 }
 
 template <typename T>
-std::vector<Point<T>> RRTPlanner<T>::getShortestPath() {
-    std::queue<Node<T>*> nodeQueue;
-    std::unordered_map<Node<T>*, Node<T>*> parentMap; // To track the parent of each node
-    std::vector<Point<T>> path;
-    
-    // Start BFS from the root node
-    nodeQueue.push(root.get());
-    parentMap[root.get()] = nullptr;
+PlanOutcome<Point<T>> RRTPlanner<T>::plan(const PlanOptions& options) {
+    PlanOutcome<Point<T>> outcome;
+    auto begin = std::chrono::steady_clock::now();
+    bool hasPath = bestCost.load() < std::numeric_limits<double>::infinity();
+    // Without a budget or a stop token an unreachable target would keep the workers busy forever
+    bool unbounded = options.timeBudget.count() == 0 && options.nodeBudget == 0 && !options.stop;
+
+    // Set when the options are rejected before any worker runs
+    bool invalidOptions = false;
+
+    if (!hasPath && (!endpointsUsable() || ((unbounded || options.proveInfeasible) && !targetReachable()))) {
+        outcome.status = PlanStatus::Infeasible;
+    } else {
+        if (!hasPath || mode == PlannerMode::Star) {
+            targetReached = false;
+            nodeBudget = options.nodeBudget;
+            nodeLimit = options.maxTreeNodes;
+            byteLimit = options.maxTreeBytes;
+            // Star mode improves the path until this call's budgets run out, not setBudget()'s
+            std::chrono::milliseconds savedTimeBudget = timeBudget;
+            std::size_t savedIterationBudget = iterationBudget;
+            timeBudget = options.timeBudget;
+            iterationBudget = 0;
+            if (options.stop) options.stop->watch(this, [this] { cancel(); });
+            auto deadline = options.timeBudget.count() != 0 ? begin + options.timeBudget : std::chrono::steady_clock::time_point::max();
+            auto waitForWorkers = [&](std::unique_lock<std::mutex>& lock) { waitForPlan(lock, options, begin, deadline); };
+
+            // A bound below what the trees take to grow at all would only prune them to nothing
+            std::size_t neededBytes = memoryBytes() + growthBytes();
+            if (byteLimit != 0 && neededBytes > byteLimit) {
+                logger->error("Memory bound of {} bytes is below the {} bytes the trees need to grow", byteLimit, neededBytes);
+                invalidOptions = true;
+            } else {
+                runWorkers(std::max(1, options.threads), waitForWorkers);
+            }
+            // The workers stop at the memory bound; prune and let them grow on while the plan lasts
+            while (pruneRequested) {
+                pruneRequested = false;
+                std::size_t live = static_cast<std::size_t>(count.load());
+                std::size_t keep = std::min(live, nodeLimit * 3 / 4);
+                std::size_t pruned = prune(keep);
+                ++outcome.prunes;
+                // Workers still extending when the bound was hit may have taken a few slots more
+                if (slotLimit != 0) slotLimit = std::max(slotLimit, slotsUsed());
+                bool finished = mode == PlannerMode::Star ? budgetSpent() : bestCost.load() < std::numeric_limits<double>::infinity();
+                if (finished || std::chrono::steady_clock::now() >= deadline) break;
+                if (static_cast<std::size_t>(count.load()) > keep) {
+                    logger->warn("Memory bound too small: only {} of {} nodes could be pruned", pruned, live - keep);
+                    break;
+                }
+                {
+                    // Reset before checking the token, so a stop from here on ends the next run at once
+                    std::lock_guard<std::mutex> lock(treeMutex);
+                    targetReached = false;
+                }
+                if (options.stop && options.stop->stopRequested()) break;
+                runWorkers(std::max(1, options.threads), waitForWorkers, true);
+            }
+
+            if (options.stop) options.stop->unwatch(this);
+            nodeBudget = 0;
+            nodeLimit = slotLimit = byteLimit = 0;
+            pruneRequested = false;
+            timeBudget = savedTimeBudget;
+            iterationBudget = savedIterationBudget;
+        }
+        if (invalidOptions) {
+            outcome.status = PlanStatus::InvalidOptions;
+        } else if (bestCost.load() < std::numeric_limits<double>::infinity()) {
+            outcome.status = PlanStatus::Found;
+        } else if (options.stop && options.stop->stopRequested()) {
+            outcome.status = PlanStatus::Cancelled;
+        } else {
+            outcome.status = PlanStatus::Timeout;
+        }
+    }
+
+    if (outcome.status == PlanStatus::Found) {
+        outcome.path = getShortestPath();
+        outcome.cost = bestCost.load();
+        outcome.remainingDistance = 0;
+    } else {
+        std::unique_lock<std::mutex> lock(treeMutex);
+        // A repair may have dropped the closest node since it was recorded
+        if (!attached(tree, closestNode)) {
+            closestNode = 0;
+            closestDistance = calculateDistance(tree.point(0), setup.target);
+            for (NodeId id = 1; id < tree.size(); ++id) {
+                double distance = calculateDistance(tree.point(id), setup.target);
+                if (attached(tree, id) && distance < closestDistance) {
+                    closestNode = id;
+                    closestDistance = distance;
+                }
+            }
+        }
+        for (NodeId id = closestNode; id != kNoNode; id = tree.parent(id)) {
+            outcome.partialPath.push_back(tree.point(id));
+        }
+        std::reverse(outcome.partialPath.begin(), outcome.partialPath.end());
+        outcome.remainingDistance = closestDistance;
+    }
+    outcome.stats = stats;
+    outcome.nodes = static_cast<std::size_t>(count.load());
+    outcome.memoryBytes = memoryBytes();
+    outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    outcome.timeToFirstPath = getTimeToFirstPath();
+    logger->info("Plan {}: {} nodes in {:.3f} ms, cost {:.1f}, {:.1f} from the target", planStatusName(outcome.status),
+                 outcome.nodes, outcome.seconds * 1e3, outcome.cost, outcome.remainingDistance);
+    return outcome;
+}
+
+template <typename T>
+PickListOutcome<Point<T>> RRTPlanner<T>::planStops(const std::vector<Point<T>>& picks, const PlanOptions& options) {
+    PickListOutcome<Point<T>> outcome;
+    auto begin = std::chrono::steady_clock::now();
+    outcome.stops.push_back(setup.start);
+    outcome.stops.insert(outcome.stops.end(), picks.begin(), picks.end());
+    std::size_t n = outcome.stops.size();
+    if (mode != PlannerMode::RRT) {
+        logger->error("Pick lists are planned in RRT mode only");
+        return outcome;
+    }
+    bool unbounded = options.timeBudget.count() == 0 && options.nodeBudget == 0 && !options.stop;
+    bool usable = startUsable();
+    for (std::size_t s = 1; usable && s < n; ++s) {
+        const Point<T>& pick = outcome.stops[s];
+        if (!targetUsable(pick) || ((unbounded || options.proveInfeasible) && !targetReachable(pick))) {
+            logger->error("Pick {} at ({}, {}) cannot be reached", s, pick.getX(), pick.getY());
+            usable = false;
+        }
+    }
+
+    if (usable) {
+        {
+            std::unique_lock<std::mutex> lock(treeMutex);
+            stops = outcome.stops;
+            stopNodes.assign(n, kNoNode);
+            stopNodes[0] = 0;
+            stopsLeft = n - 1;
+            // A tree kept from an earlier run may reach some picks already
+            for (NodeId id = 1; stopsLeft != 0 && id < tree.size(); ++id) {
+                if (!attached(tree, id)) continue;
+                for (std::size_t s = 1; s < n; ++s) {
+                    if (stopNodes[s] == kNoNode && nearGoal(tree.point(id), stops[s])) {
+                        stopNodes[s] = id;
+                        --stopsLeft;
+                    }
+                }
+            }
+        }
+        if (stopsLeft != 0) {
+            targetReached = false;
+            nodeBudget = options.nodeBudget;
+            if (options.stop) options.stop->watch(this, [this] { cancel(); });
+            auto deadline = options.timeBudget.count() != 0 ? begin + options.timeBudget : std::chrono::steady_clock::time_point::max();
+            runWorkers(std::max(1, options.threads), [&](std::unique_lock<std::mutex>& lock) { waitForPlan(lock, options, begin, deadline); });
+            if (options.stop) options.stop->unwatch(this);
+            nodeBudget = 0;
+        }
+
+        std::unique_lock<std::mutex> lock(treeMutex);
+        if (stopsLeft == 0) {
+            outcome.status = PlanStatus::Found;
+        } else if (options.stop && options.stop->stopRequested()) {
+            outcome.status = PlanStatus::Cancelled;
+        } else {
+            outcome.status = PlanStatus::Timeout;
+        }
 
-    Node<T>* targetNode = nullptr;
+        // Node ids from the root to each stop's node; two stops' legs meet where these part
+        std::vector<std::vector<NodeId>> branches(n);
+        outcome.stopPaths.resize(n);
+        for (std::size_t s = 0; s < n; ++s) {
+            for (NodeId id = stopNodes[s]; id != kNoNode; id = tree.parent(id)) {
+                branches[s].push_back(id);
+            }
+            std::reverse(branches[s].begin(), branches[s].end());
+            for (NodeId id : branches[s]) outcome.stopPaths[s].push_back(tree.point(id));
+        }
+        outcome.legCosts.assign(n * n, std::numeric_limits<double>::infinity());
+        outcome.sharedPoints.assign(n * n, 0);
+        for (std::size_t a = 0; a < n; ++a) {
+            for (std::size_t b = 0; b < n; ++b) {
+                if (branches[a].empty() || branches[b].empty()) continue;
+                auto split = std::mismatch(branches[a].begin(), branches[a].end(), branches[b].begin(), branches[b].end());
+                std::size_t shared = static_cast<std::size_t>(split.first - branches[a].begin());
+                NodeId fork = branches[a][shared - 1];
+                outcome.sharedPoints[a * n + b] = static_cast<std::uint32_t>(shared);
+                outcome.legCosts[a * n + b] = tree.cost(stopNodes[a]) + tree.cost(stopNodes[b]) - 2 * tree.cost(fork);
+            }
+        }
+        stops.clear();
+        stopNodes.clear();
+        stopsLeft = 0;
+    }
 
-    // Perform BFS to find the target node
-    while (!nodeQueue.empty()) {
-        Node<T>* currentNode = nodeQueue.front();
-        nodeQueue.pop();
+    if (outcome.status == PlanStatus::Found) {
+        outcome.order = orderStops(outcome.legCosts, n);
+        outcome.orderedCost = tourCost(outcome.legCosts, n, outcome.order);
+        std::vector<std::size_t> listed(n);
+        for (std::size_t s = 0; s < n; ++s) listed[s] = s;
+        outcome.listedCost = tourCost(outcome.legCosts, n, listed);
+    }
+    outcome.stats = stats;
+    outcome.nodes = static_cast<std::size_t>(count.load());
+    outcome.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    logger->info("Pick list {}: {} picks, {} nodes in {:.3f} ms, cost {:.1f} in the given order, {:.1f} reordered",
+                 planStatusName(outcome.status), n - 1, outcome.nodes, outcome.seconds * 1e3, outcome.listedCost, outcome.orderedCost);
+    return outcome;
+}
 
-        // Check if we've reached the target node
-        if (calculateDistance(currentNode->getPoint(), setup.target) < setup.dim * 1.5) {
-            targetNode = currentNode;
+template <typename T>
+void RRTPlanner<T>::waitForPlan(std::unique_lock<std::mutex>& lock, const PlanOptions& options, std::chrono::steady_clock::time_point begin,
+                                std::chrono::steady_clock::time_point deadline) {
+    auto done = [this] { return targetReached.load(); };
+    while (!targetReached.load()) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline) {
+            logger->info("Time budget of {} ms spent", options.timeBudget.count());
+            targetReached = true;
+            cv.notify_all();
             break;
         }
+        auto wake = options.onProgress ? std::min(deadline, now + options.progressInterval) : deadline;
+        if (wake == std::chrono::steady_clock::time_point::max()) {
+            cv.wait(lock, done);
+        } else if (!cv.wait_until(lock, wake, done) && options.onProgress && wake < deadline) {
+            PlanProgress progress;
+            progress.nodes = static_cast<std::size_t>(count.load());
+            progress.memoryBytes = memoryBytes();
+            progress.bestCost = bestCost.load();
+            progress.closestDistance = closestDistance;
+            progress.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+            lock.unlock();
+            options.onProgress(progress);
+            lock.lock();
+        }
+    }
+}
 
-        // Add children to the queue
-        for (const auto& child : currentNode->getChildren()) {
-            nodeQueue.push(child.get());
-            parentMap[child.get()] = currentNode; // Map the child to its parent
+template <typename T>
+void RRTPlanner<T>::nodeAdded(const TreeStore<T>& store, NodeId id) {
+    if (&store == &tree) {
+        double distance = calculateDistance(store.point(id), setup.target);
+        if (distance < closestDistance) {
+            closestDistance = distance;
+            closestNode = id;
+        }
+    }
+    if (stopsLeft != 0 && &store == &tree) {
+        Point<T> p = store.point(id);
+        for (std::size_t s = 1; s < stops.size(); ++s) {
+            if (stopNodes[s] == kNoNode && nearGoal(p, stops[s])) {
+                stopNodes[s] = id;
+                --stopsLeft;
+            }
+        }
+        if (stopsLeft == 0 && !targetReached.load()) {
+            logger->info("All {} picks reached after {} nodes", stops.size() - 1, count.load(std::memory_order_relaxed));
+            targetReached = true;
+            cv.notify_all();
+            return;
+        }
+    }
+    if (nodeBudget != 0 && static_cast<std::size_t>(count.load(std::memory_order_relaxed)) >= nodeBudget && !targetReached.load()) {
+        logger->info("Node budget of {} spent", nodeBudget);
+        targetReached = true;
+        cv.notify_all();
+        return;
+    }
+    if (byteLimit != 0 && slotLimit == 0 && memoryBytes() + growthBytes() > byteLimit) {
+        // What is allocated now is all the bound allows; prunes free slots for reuse from here on
+        slotLimit = slotsUsed();
+        std::size_t live = static_cast<std::size_t>(count.load(std::memory_order_relaxed));
+        nodeLimit = nodeLimit != 0 ? std::min(nodeLimit, live) : live;
+        logger->info("Memory bound of {} bytes reached at {} nodes", byteLimit, live);
+    }
+    if (((nodeLimit != 0 && static_cast<std::size_t>(count.load(std::memory_order_relaxed)) >= nodeLimit) ||
+         (slotLimit != 0 && slotsUsed() > slotLimit)) && !targetReached.load()) {
+        pruneRequested = true;
+        targetReached = true;
+        cv.notify_all();
+    }
+}
+
+template <typename T>
+std::size_t RRTPlanner<T>::prune(std::size_t keep) {
+    std::unique_lock<std::mutex> lock(treeMutex);
+    // Even with nothing to prune, the slots of nodes dropped by a repair are reclaimed
+    std::size_t live = static_cast<std::size_t>(count.load());
+    std::size_t excess = live > keep ? live - keep : 0, pruned;
+    if (goalIndex) {
+        // Each tree gives up its share of the excess
+        std::size_t startLive = 0;
+        for (NodeId id = 0; id < tree.size(); ++id) startLive += attached(tree, id);
+        std::size_t fromStart = excess * startLive / std::max<std::size_t>(live, 1);
+        pruned = pruneStore(tree, *index, setup.target, connectStart, fromStart) +
+                 pruneStore(goalTree, *goalIndex, setup.start, connectGoal, excess - fromStart);
+    } else {
+        pruned = pruneStore(tree, *index, setup.target, goalNode, excess);
+    }
+    count.fetch_sub(static_cast<int>(pruned));
+    stats.pruned += pruned;
+    goalCandidates.erase(std::remove_if(goalCandidates.begin(), goalCandidates.end(), [this](NodeId g) { return !attached(tree, g); }),
+                         goalCandidates.end());
+    edgeValidity.clear();
+    if (!attached(tree, closestNode)) {
+        closestNode = 0;
+        closestDistance = calculateDistance(tree.point(0), setup.target);
+        for (NodeId id = 1; id < tree.size(); ++id) {
+            double distance = calculateDistance(tree.point(id), setup.target);
+            if (attached(tree, id) && distance < closestDistance) {
+                closestNode = id;
+                closestDistance = distance;
+            }
+        }
+    }
+    logger->info("Pruned {} of {} nodes to stay within the memory bound ({} bytes)", pruned, live, memoryBytes());
+    return pruned;
+}
+
+template <typename T>
+std::size_t RRTPlanner<T>::pruneStore(TreeStore<T>& store, Index& idx, const Point<T>& towards, NodeId protect, std::size_t remove) {
+    std::vector<bool> kept(store.size());
+    kept[0] = true;
+    for (NodeId id = protect; id != kNoNode; id = store.parent(id)) kept[id] = true;
+
+    // Leaves only, so the branches that carry the tree's reach survive; a round of pruning can
+    // expose new leaves for the next. Highest cost to come plus distance to go goes first.
+    std::size_t pruned = 0;
+    std::vector<std::pair<double, NodeId>> ranked;
+    while (pruned < remove) {
+        ranked.clear();
+        for (NodeId id = 1; id < store.size(); ++id) {
+            if (!kept[id] && attached(store, id) && store.firstChild(id) == kNoNode) {
+                ranked.emplace_back(store.cost(id) + calculateDistance(store.point(id), towards), id);
+            }
+        }
+        if (ranked.empty()) break;
+        std::size_t take = std::min(remove - pruned, ranked.size());
+        std::nth_element(ranked.begin(), ranked.begin() + (take - 1), ranked.end(),
+                         [](const auto& a, const auto& b) { return a.first > b.first; });
+        for (std::size_t i = 0; i < take; ++i) {
+            store.setParent(ranked[i].second, kNoNode);
+            store.setCost(ranked[i].second, std::numeric_limits<double>::infinity());
+        }
+        pruned += take;
+    }
+
+    // Rebuilt rather than removed from, so the index keeps its footprint too
+    idx.clear();
+    for (NodeId id = 0; id < store.size(); ++id) {
+        if (attached(store, id)) idx.insert(store.point(id), id);
+    }
+    store.reclaimDetached();
+    return pruned;
+}
+
+template <typename T>
+bool RRTPlanner<T>::startUsable() const {
+    double inv = 1.0 / setup.dim;
+    if (volume) {
+        return volume->inBounds(static_cast<int>(setup.start.getX() * inv), static_cast<int>(setup.start.getY() * inv), static_cast<int>(setup.start.getZ() * inv));
+    }
+    return setup.arena.inBounds(static_cast<int>(setup.start.getX() * inv), static_cast<int>(setup.start.getY() * inv));
+}
+
+template <typename T>
+bool RRTPlanner<T>::targetUsable(const Point<T>& target) const {
+    double inv = 1.0 / setup.dim;
+    if (volume) {
+        return volume->inBounds(static_cast<int>(target.getX() * inv), static_cast<int>(target.getY() * inv), static_cast<int>(target.getZ() * inv));
+    }
+    int tx = static_cast<int>(target.getX() * inv), ty = static_cast<int>(target.getY() * inv);
+    for (int y = ty - 2; y <= ty + 2; ++y) {
+        for (int x = tx - 2; x <= tx + 2; ++x) {
+            if (checker.pointFree((x + 0.5) * setup.dim, (y + 0.5) * setup.dim)) return true;
+        }
+    }
+    return false;
+}
+
+template <typename T>
+bool RRTPlanner<T>::targetReachable(const Point<T>& target) const {
+    if (volume) return true;
+    const OccupancyGrid& grid = setup.arena;
+    double inv = 1.0 / setup.dim;
+    int sx = static_cast<int>(setup.start.getX() * inv), sy = static_cast<int>(setup.start.getY() * inv);
+    int tx = static_cast<int>(target.getX() * inv), ty = static_cast<int>(target.getY() * inv);
+    if (!grid.inBounds(sx, sy)) return false;
+
+    // Edges leave a node's own cell untested, so the start cell is entered even when blocked;
+    // a node within 1.5 cells of the target (two cells of its cell) reaches it
+    std::vector<std::uint8_t> seen(static_cast<std::size_t>(grid.cols()) * grid.rows());
+    std::vector<std::pair<int, int>> queue{{sx, sy}};
+    seen[static_cast<std::size_t>(sy) * grid.cols() + sx] = 1;
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        int x = queue[head].first, y = queue[head].second;
+        if (std::abs(x - tx) <= 2 && std::abs(y - ty) <= 2) return true;
+        for (int dy = -1; dy <= 1; ++dy) {
+            for (int dx = -1; dx <= 1; ++dx) {
+                int nx = x + dx, ny = y + dy;
+                if (!grid.inBounds(nx, ny)) continue;
+                std::uint8_t& s = seen[static_cast<std::size_t>(ny) * grid.cols() + nx];
+                if (s || !checker.pointFree((nx + 0.5) * setup.dim, (ny + 0.5) * setup.dim)) continue;
+                s = 1;
+                queue.emplace_back(nx, ny);
+            }
+        }
+    }
+    logger->info("Target is not connected to the start through free cells");
+    return false;
+}
+
+template <typename T>
+std::vector<Point<T>> RRTPlanner<T>::getShortestPath() {
+    // Star mode may still be rewiring parent links from worker threads
+    std::unique_lock<std::mutex> lock(treeMutex);
+    std::vector<Point<T>> path;
+
+    // Connect mode: start tree up to the meeting point, then down the goal tree to the target
+    if (mode == PlannerMode::Connect) {
+        if (connectStart == kNoNode) {
+            logger->error("Target node not reachable.");
+            return path;
+        }
+        for (NodeId id = connectStart; id != kNoNode; id = tree.parent(id)) {
+            path.push_back(tree.point(id));
+        }
+        std::reverse(path.begin(), path.end());
+        // The meeting node exists in both trees; skip its goal-tree copy
+        for (NodeId id = goalTree.parent(connectGoal); id != kNoNode; id = goalTree.parent(id)) {
+            path.push_back(goalTree.point(id));
+        }
+        return path;
+    }
+
+    NodeId targetNode = goalNode;
+
+    // Fall back to the first node (in insertion order) that is close enough to the target; lazy
+    // trees have unchecked edges, so only their validated goal counts
+    for (NodeId id = 0; targetNode == kNoNode && mode != PlannerMode::Lazy && id < tree.size(); ++id) {
+        if (attached(tree, id) && nearTarget(tree.point(id))) {
+            targetNode = id;
         }
     }
 
     // If targetNode is found, trace the path from the target node back to the root
-    if (targetNode) {
-        Node<T>* currentNode = targetNode;
-        while (currentNode != nullptr) {
-            path.push_back(currentNode->getPoint());
-            currentNode = parentMap[currentNode]; // Move to the parent node
+    if (targetNode != kNoNode) {
+        for (NodeId id = targetNode; id != kNoNode; id = tree.parent(id)) {
+            path.push_back(tree.point(id));
         }
 
         // Reverse the path to start from the root
@@ -228,3 +1164,177 @@ std::vector<Point<T>> RRTPlanner<T>::getShortestPath() {
     return path;
 }
 
+template <typename T>
+RepairStats RRTPlanner<T>::addObstacles(const ObstacleBatch& batch) {
+    return applyChange(batch, false);
+}
+
+template <typename T>
+RepairStats RRTPlanner<T>::removeObstacles(const ObstacleBatch& batch) {
+    return applyChange(batch, true);
+}
+
+template <typename T>
+RepairStats RRTPlanner<T>::applyChange(const ObstacleBatch& batch, bool remove) {
+    RepairStats repair;
+    if (volume) {
+        logger->error("Error: obstacle changes on a live planner need a 2D arena.");
+        return repair;
+    }
+    if (!editableSetup) {
+        logger->error("Error: obstacle changes need a planner built on a non-const Setup.");
+        return repair;
+    }
+    auto begin = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(treeMutex);
+    ObstacleRasterizer::Result change = remove ? editableSetup->removeObstacles(batch) : editableSetup->addObstacles(batch);
+    repair.tilesDropped = checker.refresh();
+    // Lazy mode: checked edges may have changed either way
+    edgeValidity.clear();
+
+    // Freeing cells cannot block an edge
+    if (!remove && change.cellsMarked > 0) {
+        // Cells the robot can no longer enter are within its footprint of the new obstacle cells;
+        // the window is in cells, so the reach is the footprint radius in cells
+        int reach = static_cast<int>(std::ceil(checker.footprintRadiusCells())) + 2;
+        int x0 = change.x0 - reach, y0 = change.y0 - reach, x1 = change.x1 + reach, y1 = change.y1 + reach;
+        repairTree(tree, *index, x0, y0, x1, y1, repair);
+        if (goalIndex) repairTree(goalTree, *goalIndex, x0, y0, x1, y1, repair);
+    }
+    revalidatePath(repair);
+    repair.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    logger->info("Tree repaired in {:.3f} ms: {} edges checked, {} blocked, {} nodes orphaned, {} reattached, {} dropped; path {}",
+                 repair.seconds * 1e3, repair.edgesChecked, repair.edgesBlocked, repair.orphaned, repair.reattached, repair.dropped,
+                 repair.pathValid ? "kept" : "lost");
+    return repair;
+}
+
+template <typename T>
+void RRTPlanner<T>::repairTree(TreeStore<T>& store, Index& idx, int x0, int y0, int x1, int y1, RepairStats& repair) {
+    // An edge crossing the window has both ends within one edge length of it
+    double maxEdge = maxEdgeLength();
+    double bx0 = x0 * setup.dim, by0 = y0 * setup.dim, bx1 = (x1 + 1) * setup.dim, by1 = (y1 + 1) * setup.dim;
+    Point<T> centre(static_cast<T>((bx0 + bx1) / 2), static_cast<T>((by0 + by1) / 2));
+    std::vector<NodeId> near;
+    idx.radius(centre, std::hypot(bx1 - bx0, by1 - by0) / 2 + maxEdge + 1, near);
+
+    std::vector<NodeId> cut;
+    for (NodeId n : near) {
+        NodeId parent = store.parent(n);
+        if (parent == kNoNode) continue;
+        double x = store.x(n), y = store.y(n);
+        double dx = std::max({bx0 - x, 0.0, x - bx1}), dy = std::max({by0 - y, 0.0, y - by1});
+        if (dx * dx + dy * dy > maxEdge * maxEdge) continue;
+        ++repair.edgesChecked;
+        if (!edgeFree(store.point(parent), store.point(n))) cut.push_back(n);
+    }
+    repair.edgesBlocked += cut.size();
+    if (cut.empty()) return;
+
+    // Everything below a blocked edge is orphaned. Orphans are detached, then regain parents in
+    // order of cost, as a Dijkstra wavefront from the nodes that kept theirs; each orphan holds
+    // the cost of its best free candidate so far, so only improving candidates are ever checked.
+    std::unordered_map<NodeId, double> orphans;
+    std::vector<NodeId> order;
+    for (NodeId c : cut) {
+        if (orphans.count(c)) continue;
+        rewireStack.assign(1, c);
+        while (!rewireStack.empty()) {
+            NodeId id = rewireStack.back();
+            rewireStack.pop_back();
+            if (!orphans.emplace(id, std::numeric_limits<double>::infinity()).second) continue;
+            order.push_back(id);
+            store.forEachChild(id, [this](NodeId child) { rewireStack.push_back(child); });
+        }
+    }
+    for (NodeId o : order) {
+        store.setParent(o, kNoNode);
+        store.setCost(o, std::numeric_limits<double>::infinity());
+    }
+    repair.orphaned += order.size();
+
+    using Candidate = std::tuple<double, NodeId, NodeId>;  // cost through parent, orphan, parent
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> open;
+    std::vector<std::pair<double, NodeId>> parents;
+    for (NodeId o : order) {
+        Point<T> p = store.point(o);
+        // Orphans the robot can no longer stand on are dropped without trying any edge
+        if (!checker.pointFree(p.getX(), p.getY())) {
+            orphans.erase(o);
+            continue;
+        }
+        near.clear();
+        idx.radius(p, maxEdge, near);
+        parents.clear();
+        for (NodeId n : near) {
+            if (attached(store, n)) parents.emplace_back(store.cost(n) + calculateDistance(store.point(n), p), n);
+        }
+        // The cheapest free one is the only one that matters
+        std::sort(parents.begin(), parents.end());
+        for (auto& [cost, n] : parents) {
+            if (edgeFree(store.point(n), p)) {
+                orphans[o] = cost;
+                open.emplace(cost, o, n);
+                break;
+            }
+        }
+    }
+    while (!open.empty()) {
+        auto [cost, o, parent] = open.top();
+        open.pop();
+        if (attached(store, o) || cost > orphans[o]) continue;
+        store.setParent(o, parent);
+        store.setCost(o, cost);
+        ++repair.reattached;
+        Point<T> p = store.point(o);
+        near.clear();
+        idx.radius(p, maxEdge, near);
+        for (NodeId n : near) {
+            auto it = orphans.find(n);
+            if (it == orphans.end() || attached(store, n)) continue;
+            double through = cost + calculateDistance(p, store.point(n));
+            if (through < it->second && edgeFree(p, store.point(n))) {
+                it->second = through;
+                open.emplace(through, n, o);
+            }
+        }
+    }
+
+    // The rest leave the index, so the tree never grows from them again
+    for (NodeId o : order) {
+        if (attached(store, o)) continue;
+        idx.remove(store.point(o), o);
+        ++repair.dropped;
+        count.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+void RRTPlanner<T>::revalidatePath(RepairStats& repair) {
+    if (mode == PlannerMode::Connect) {
+        if (connectStart != kNoNode && (!attached(tree, connectStart) || !attached(goalTree, connectGoal))) {
+            connectStart = connectGoal = kNoNode;
+        }
+        bestCost = connectStart != kNoNode ? tree.cost(connectStart) + goalTree.cost(connectGoal) : std::numeric_limits<double>::infinity();
+    } else {
+        // Costs below a reattached node changed, so the cheapest candidate may be another one
+        if (goalNode != kNoNode && !attached(tree, goalNode)) goalNode = kNoNode;
+        for (NodeId g : goalCandidates) {
+            if (attached(tree, g) && (goalNode == kNoNode || tree.cost(g) < tree.cost(goalNode))) goalNode = g;
+        }
+        bestCost = goalNode != kNoNode ? tree.cost(goalNode) : std::numeric_limits<double>::infinity();
+    }
+    repair.pathValid = bestCost.load() < std::numeric_limits<double>::infinity();
+    sampler->pathCostImproved(bestCost.load());
+}
+
+template <typename T>
+void RRTPlanner<T>::replan(int num_threads) {
+    if (mode != PlannerMode::Star && bestCost.load() < std::numeric_limits<double>::infinity()) return;
+    targetReached = false;
+    iterations = 0;
+    firstPathTime = std::chrono::steady_clock::duration{0};
+    stats = PlannerStats{};
+    metrics = PhaseMetrics{};
+    start(num_threads);
+}
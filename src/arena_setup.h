@@ -3,63 +3,116 @@
 #include <vector>
 #include <memory>
 #include <queue>
+#include <tuple>
 #include <cmath>
 #include <random>
 #include <unordered_set>
+#include <unordered_map>
 #include <mutex>
 #include <thread>
 #include <chrono>
 #include <ctime>
 #include <sstream>
 #include <condition_variable>
+#include <atomic>
+#include <type_traits>
 #include <SFML/Graphics.hpp>
+// Hot-path log statements use the SPDLOG_LOGGER_* macros and are compiled out below this level
+#ifndef SPDLOG_ACTIVE_LEVEL
+#define SPDLOG_ACTIVE_LEVEL SPDLOG_LEVEL_INFO
+#endif
 //#include <prometheus/exposer.h>
 //#include <prometheus/registry.h>
 //#include <prometheus/gauge.h>
 //#include <prometheus/counter.h>
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/basic_file_sink.h> // To log to a file
+#include <spdlog/async.h>
 #include <iomanip>
+#include "nearest_index.h"
+#include "tree_store.h"
+#include "tiled_map.h"
+#include "occupancy_grid.h"
+#include "clearance_map.h"
+#include "collision_checker.h"
+#include "voxel_map.h"
+#include "obstacle_raster.h"
+#include "sampler.h"
+#include "planner_metrics.h"
+#include "plan_options.h"
+#include "pick_list.h"
 
 extern std::shared_ptr<spdlog::logger> logger;
 std::shared_ptr<spdlog::logger> logger;  // Declare the logger globally
 
-// Templated Point structure for 2D and 3D space
-template <typename T>
+// Point of scalar T in D = 2 or 3 dimensions (D defaults to 3, see tree_store.h). A 2D point
+// stores only x and y (8 bytes for float), aligned to its size so arrays of them load as one
+// vector lane per point; getZ() is a constant 0 there and modify_z() does nothing. The
+// (x, y, z) constructor drops z in 2D. The planner's points are 3D, since a Setup is 2D or 3D
+// only at runtime; structures that are 2D by construction (the service's roadmap) use D = 2.
+template <typename T, int D>
 class Point {
-    T x, y, z;
+    static_assert(D == 2 || D == 3, "Point is 2D or 3D");
+    alignas(D == 2 ? 2 * sizeof(T) : alignof(T)) T c[D];
 public:
-    Point() : x(0), y(0), z(0) {}
-    Point(T x, T y) : x(x), y(y), z(0) {}
-    Point(T x, T y, T z) : x(x), y(y), z(z) {}
-
-    T getX() const { return x; }
-    T getY() const { return y; }
-    T getZ() const { return z; }
-    void modify_x(T x) { this->x = x; } 
-    void modify_y(T y) { this->y = y; }
-    void modify_z(T z) { this->z = z; }
+    static constexpr int Dims = D;
+    using Scalar = T;
+
+    Point() : c{} {}
+    Point(T x, T y) : c{x, y} {}
+    Point(T x, T y, T z) {
+        c[0] = x;
+        c[1] = y;
+        if constexpr (D == 3) c[2] = z;
+    }
+    // Between dimensions: 3D to 2D drops z, 2D to 3D sets it to 0
+    template <int E, typename = std::enable_if_t<E != D>>
+    explicit Point(const Point<T, E>& other) : Point(other.getX(), other.getY(), other.getZ()) {}
+
+    T getX() const { return c[0]; }
+    T getY() const { return c[1]; }
+    T getZ() const {
+        if constexpr (D == 3) return c[2];
+        else return T(0);
+    }
+    void modify_x(T x) { c[0] = x; }
+    void modify_y(T y) { c[1] = y; }
+    void modify_z(T z) {
+        if constexpr (D == 3) c[2] = z;
+    }
     void print() const 
     {
-        std::cout << "(" << x << ", " << y << ", " << z << ")" << std::endl;
+        std::cout << "(" << getX() << ", " << getY() << ", " << getZ() << ")" << std::endl;
     }
 
     bool operator==(const Point& other) const {
-        return x == other.x && y == other.y && z == other.z;
+        for (int i = 0; i < D; ++i) {
+            if (c[i] != other.c[i]) return false;
+        }
+        return true;
     }
 };
 
-template <typename T>
+static_assert(sizeof(Point<float, 2>) == 8, "2D float points are two packed floats");
+
+// Mixes every coordinate (boost::hash_combine); plain XOR-shifting let (x, y) and (y, x)
+// patterns collide
+template <typename T, int D = 3>
 struct PointHash {
-    std::size_t operator()(const Point<T>& p) const {
-        return std::hash<T>()(p.getX()) ^ (std::hash<T>()(p.getY()) << 1) ^ (std::hash<T>()(p.getZ()) << 2);
+    std::size_t operator()(const Point<T, D>& p) const {
+        std::size_t h = 0;
+        auto combine = [&h](T v) { h ^= std::hash<T>()(v) + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2); };
+        combine(p.getX());
+        combine(p.getY());
+        if constexpr (D == 3) combine(p.getZ());
+        return h;
     }
 };
 
-template <typename T>
+template <typename T, int D = 3>
 struct PointEqual {
-    bool operator()(const Point<T>& lhs, const Point<T>& rhs) const {
-        return lhs.getX() == rhs.getX() && lhs.getY() == rhs.getY() && lhs.getZ() == rhs.getZ();
+    bool operator()(const Point<T, D>& lhs, const Point<T, D>& rhs) const {
+        return lhs == rhs;
     }
 };
 
@@ -71,79 +124,112 @@ public:
     Robot() : length(0), width(0), height(0) {} 
     Robot(T length, T width) : length(length), width(width), height(0) {} 
     Robot(T length, T width, T height) : length(length), width(width), height(height) {} 
-    int getlength() const {
+    T getlength() const {
         return length;
     }
-    int getwidth() const {
+    T getwidth() const {
         return width;
     }
-    int getheight() const {
+    T getheight() const {
         return height;
     }
 };
 
-// Node structure for RRT tree
-template <typename T>
-class Node {
-    Point<T> point;
-    Node* parent;
-    std::vector<std::unique_ptr<Node<T>>> children;
-public:
-    Node(Point<T> point, Node* parent = nullptr) 
-        : point(point), parent(parent) {}
-
-    const Point<T>& getPoint() const { return point; }
-    Node* getParent() const { return parent; }
-
-    void addChild(std::unique_ptr<Node<T>> child) {
-        children.push_back(std::move(child));
-    }
-
-    const std::vector<std::unique_ptr<Node<T>>>& getChildren() const {
-        return children;
-    }
-};
-
 // Setup class with arena configuration
 template <typename T>
 class Setup {
 public:
     Robot<T> robot;
     T length, width, height, step_size,dim;
-    std::vector<std::vector<int>> arena;
+    OccupancyGrid arena;
+    // Distance from each cell to the nearest obstacle, kept up to date by markCell. A lazily filled
+    // cache behind its own mutex, so planners working from a const Setup may fill it.
+    mutable ClearanceMap clearance;
+    // 3D arenas only: sparse voxel occupancy with cubic voxels of side dim. 'arena' then holds
+    // the floor projection of the obstacles, which is what visualize() draws.
+    std::unique_ptr<VoxelMap> volume;
     Point<T> start, target;
     std::unordered_set<Point<T>, PointHash<T>, PointEqual<T>> points;
 
     Setup(T l,T w,T length, T width, Point<T> start, Point<T> target, T step_size)
-        :robot(l,w), length(length), width(width), start(start), target(target), dim(std::max(l,w)),step_size(step_size) {
-        arena.resize(std::ceil(width / dim), std::vector<int>(std::ceil(length / dim), 0));
-        
+        :robot(l,w), length(length), width(width), height(0), step_size(step_size), dim(std::max(l,w)),
+        arena(std::ceil(static_cast<double>(length) / std::max(l,w)), std::ceil(static_cast<double>(width) / std::max(l,w))),
+        clearance(arena), start(start), target(target) {
+        logSetup();
+    }
+
+    // 3D arena of length x width x height for a robot of size l x w x h
+    Setup(T l, T w, T h, T length, T width, T height, Point<T> start, Point<T> target, T step_size)
+        :robot(l,w,h), length(length), width(width), height(height), step_size(step_size), dim(std::max(l,w)),
+        arena(std::ceil(static_cast<double>(length) / std::max(l,w)), std::ceil(static_cast<double>(width) / std::max(l,w))),
+        clearance(arena),
+        volume(std::make_unique<VoxelMap>(arena.cols(), arena.rows(), static_cast<int>(std::ceil(static_cast<double>(height) / std::max(l,w))))),
+        start(start), target(target) {
+        logSetup();
+    }
+
+    // 2D arena loaded from a .rrtmap file: the map's cell size becomes the unit cell size and
+    // its tiles are paged in as the planner reaches them
+    Setup(T l, T w, std::unique_ptr<TiledMapFile> map, Point<T> start, Point<T> target, T step_size)
+        :robot(l,w), height(0), step_size(step_size), dim(static_cast<T>(map->cellSize())),
+        arena(std::move(map)),
+        clearance(arena), start(start), target(target) {
+        length = static_cast<T>(arena.cols() * dim);
+        width = static_cast<T>(arena.rows() * dim);
+        logSetup();
+    }
+
+    bool is3D() const { return volume != nullptr; }
+
+    // Write the obstacle grid as a .rrtmap file (for 3D arenas, the floor projection)
+    bool saveMap(const std::string& path) const;
+
+private:
+    ObstacleRasterizer::Result rasterize(const ObstacleBatch& batch, int threads, bool clear = false);
+
+public:
+
+    void logSetup() const {
         // Logger print statements
         logger->info("Initializing Setup...");
         logger->debug("Length: {}, Width: {}", length, width);
         logger->debug("Start Point: ({}, {})", start.getX(), start.getY());
         logger->debug("Target Point: ({}, {})", target.getX(), target.getY());
-        logger->debug("Robot Length: {}, Robot Width: {}", l, w);
+        logger->debug("Robot Length: {}, Robot Width: {}, Robot Height: {}", robot.getlength(), robot.getwidth(), robot.getheight());
         logger->debug("Step Size: {}", step_size);
-        logger->debug("Arena Dimensions: {}x{}", arena.size(), arena[0].size());
+        logger->debug("Arena Dimensions: {}x{}", arena.rows(), arena.cols());
+        if (volume) logger->debug("Arena Height: {} ({} voxel layers)", height, volume->sizeZ());
+        if (const TiledMapFile* map = arena.mapFile()) {
+            logger->info("Arena mapped from file: {} bytes, {} of {} tiles stored", map->fileBytes(), map->dataTileCount(), map->tileCount());
+        }
+        logger->info("Arena memory footprint: {} bytes", arena.memoryBytes() + (volume ? volume->memoryBytes() : 0));
         logger->debug("Unit cell size: {}", dim);
         logger->info("Setup complete.");
     }
 
+    // True if the point lies inside the arena and not on an obstacle cell (voxel in 3D)
     bool isValid(const Point<T>& point) const {
         int x = static_cast<int>(point.getX() / dim);
         int y = static_cast<int>(point.getY() / dim);
-        return x >= 0 && x < std::ceil(length / dim) && y >= 0 && y < std::ceil(width/ dim) && arena[y][x] == 0;
+        if (volume) return !volume->isOccupied(x, y, static_cast<int>(point.getZ() / dim));
+        return arena.isFree(x, y);
     }
 
+    // value -1 marks an obstacle, 0 clears it
     void markCell(const Point<T>& point, int value) {
     int x = static_cast<int>(point.getX() / dim);
     int y = static_cast<int>(point.getY() / dim);
     
-    if (x >= 0 && x < arena[0].size() && y >= 0 && y < arena.size()) 
+    if (arena.inBounds(x, y)) 
     {
-            arena[y][x] = value;
-            logger->debug("Marked cell at ({}, {}) with value {}", x, y, value);
+            if (value == -1) {
+                arena.setObstacle(x, y, true);
+                clearance.markChanged(x, y);
+            } else {
+                if (arena.isObstacle(x, y)) clearance.markChanged(x, y);
+                arena.setObstacle(x, y, false);
+            }
+            SPDLOG_LOGGER_TRACE(logger, "Marked cell at ({}, {}) with value {}", x, y, value);
     }
    else 
     {
@@ -151,159 +237,414 @@ public:
     }
     }
 
+    // Mark every cell the polygon (given by its corners in order) touches as an obstacle
     void addObstacle(const std::vector<Point<T>>& obstacle);
+
+    // Rasterize a whole batch of polygons and circles into the arena, split across threads;
+    // reports and logs the ingestion throughput
+    ObstacleRasterizer::Result addObstacles(const ObstacleBatch& batch, int threads = std::max(1u, std::thread::hardware_concurrency()));
+
+    // Free every cell the batch's shapes touch (e.g. a pallet that was moved away)
+    ObstacleRasterizer::Result removeObstacles(const ObstacleBatch& batch, int threads = std::max(1u, std::thread::hardware_concurrency()));
+
+    // 3D arenas: mark the axis-aligned box between two opposite corners as occupied
+    void addBox(const Point<T>& corner, const Point<T>& opposite);
+
+    // Radius of the disc covering the robot in any orientation (half its diagonal), in world units
+    double footprintRadius() const {
+        return std::hypot(static_cast<double>(robot.getlength()), static_cast<double>(robot.getwidth())) / 2.0;
+    }
+
+    // Cells around an obstacle that the robot body can reach when its centre is in a free cell
+    // (used to dilate the 3D voxel map)
+    int footprintCells() const {
+        double halfExtent = std::max({robot.getlength(), robot.getwidth(), robot.getheight()}) / 2.0;
+        return static_cast<int>(std::ceil(halfExtent / dim));
+    }
+};
+
+// How RRTPlanner grows its trees
+enum class PlannerMode {
+    RRT,        // one tree from the start, stops when a node lands near the target
+    Connect,    // RRT-Connect: trees from start and target, greedily joined after every extension
+    Star,       // anytime RRT*: keeps rewiring towards lower cost paths until the budget is spent
+    Lazy        // lazy RRT: edges join after an endpoint check and are only checked along a path that
+                // reaches the target; failed edges are repaired and the tree grows on
 };
 
+inline const char* plannerModeName(PlannerMode mode) {
+    switch (mode) {
+    case PlannerMode::RRT: return "rrt";
+    case PlannerMode::Connect: return "connect";
+    case PlannerMode::Star: return "star";
+    case PlannerMode::Lazy: return "lazy";
+    }
+    return "unknown";
+}
+
 // RRTPlanner with multi-threading and explicit functions
 // RRTPlanner with multi-threading and explicit functions
 template <typename T>
 class RRTPlanner {
-    std::mt19937 gen;
-    std::uniform_real_distribution<> distX, distY;
-    Setup<T>& setup;
-    std::unique_ptr<Node<T>> root;
+public:
+    using Index = NearestIndex<Point<T>, NodeId>;
+    using PointSampler = Sampler<Point<T>>;
+    using Stream = SampleStream<Point<T>>;
+
+private:
+    unsigned seed;
+    const Setup<T>& setup;
+    // The same Setup when the planner may change its obstacles (addObstacles); null otherwise
+    Setup<T>* editableSetup = nullptr;
+    // Longest extension towards a sample; the Setup's step_size unless overridden
+    double stepSize;
+    TreeStore<T> tree;
+    std::unique_ptr<Index> index;
+    std::unique_ptr<PointSampler> sampler;
+    CollisionChecker checker;
+    // 3D arenas: the voxel map dilated by the robot footprint; null in 2D
+    std::unique_ptr<VoxelMap> volume;
+    NodeId goalNode = kNoNode;
+    PlannerMode mode = PlannerMode::RRT;
+    // Connect mode: tree rooted at the target and the pair of nodes where the two trees met
+    TreeStore<T> goalTree;
+    std::unique_ptr<Index> goalIndex;
+    NodeId connectStart = kNoNode, connectGoal = kNoNode;
+    // Star mode: nodes close enough to the target, the run budget and the best path found so far
+    std::vector<NodeId> goalCandidates;
+    std::vector<NodeId> rewireStack;
+    std::chrono::milliseconds timeBudget{0};
+    std::size_t iterationBudget = 0;
+    std::chrono::steady_clock::time_point startTime;
+    std::atomic<std::size_t> iterations{0};
+    std::atomic<double> bestCost{std::numeric_limits<double>::infinity()};
+    PlannerStats stats;
+    PhaseMetrics metrics;
+    std::chrono::steady_clock::duration firstPathTime{0};
+    // Serializes tree/index inserts only; nearest queries on a concurrent index run without it
     std::mutex treeMutex;
     std::condition_variable cv;
-    bool targetReached = false;
-    int count;
+    std::atomic<bool> targetReached{false};
+    std::atomic<int> count;
+    // plan(): memory bound of the current call. A prune is due at nodeLimit live nodes, or once the
+    // trees take more than slotLimit node slots; both are fixed when the storage reaches byteLimit.
+    // pruneRequested tells plan() the workers stopped for one. Guarded by treeMutex.
+    std::size_t nodeLimit = 0, slotLimit = 0, byteLimit = 0;
+    bool pruneRequested = false;
+    // planStops(): the start and the picks, the node that reached each (kNoNode until one has) and
+    // how many picks are still unreached; guarded by treeMutex
+    std::vector<Point<T>> stops;
+    std::vector<NodeId> stopNodes;
+    std::size_t stopsLeft = 0;
+    // plan(): node budget of the current call, and the start-tree node nearest the target
+    std::size_t nodeBudget = 0;
+    NodeId closestNode = 0;
+    double closestDistance;
+    // Lazy mode: outcome of every edge checked so far, keyed by edgeKey(parent, child); guarded by
+    // treeMutex and cleared when obstacles change
+    std::unordered_map<std::uint64_t, bool> edgeValidity;
 
 public: // Add this to declare public members
-    RRTPlanner(Setup<T>& setup) 
-        : gen(std::random_device{}()), distX(0, setup.length), distY(0, setup.width), count(1), setup(setup),
-        root(std::make_unique<Node<T>>(setup.start)) {
-        setup.markCell(setup.start, 1);
+    // Each worker thread derives its own random stream from 'seed'. A planner built on a const
+    // Setup only reads it and cannot take obstacle changes.
+    RRTPlanner(Setup<T>& setup, unsigned seed = std::random_device{}())
+        : RRTPlanner(static_cast<const Setup<T>&>(setup), seed) {
+        editableSetup = &setup;
+    }
+    RRTPlanner(const Setup<T>& setup, unsigned seed = std::random_device{}())
+        : seed(seed), setup(setup), stepSize(setup.step_size), tree(setup.is3D() ? 3 : 2),
+        index(makeIndex()),
+        sampler(std::make_unique<UniformSampler<Point<T>>>(setup.length, setup.width, setup.height)),
+        checker(setup.clearance, setup.dim, setup.footprintRadius()), goalTree(tree.dimensions()), count(1) {
+        if (setup.is3D()) volume = std::make_unique<VoxelMap>(setup.volume->dilated(setup.footprintCells()));
+        NodeId root = tree.add(setup.start, kNoNode);
+        index->insert(setup.start, root);
+        closestDistance = calculateDistance(setup.start, setup.target);
+    }
+    const TreeStore<T>& getTree() const { return tree; }
+    const TreeStore<T>& getGoalTree() const { return goalTree; }
+    const CollisionChecker& getCollisionChecker() const { return checker; }
+    // Dilated voxel map of a 3D arena, null for 2D
+    const VoxelMap* getVolume() const { return volume.get(); }
+    int nodeCount() const { return count.load(); }
+    // Bytes held by the trees and their nearest-neighbour indexes; not during start()/plan()
+    std::size_t memoryBytes() const {
+        std::size_t bytes = tree.memoryBytes() + index->memoryBytes();
+        if (goalIndex) bytes += goalTree.memoryBytes() + goalIndex->memoryBytes();
+        return bytes;
+    }
+
+    // Replace the nearest-neighbour index (e.g. with a KdTreeIndex); existing nodes are re-inserted.
+    // Only the start tree is affected; the Connect-mode goal tree always uses a GridIndex.
+    void setNearestIndex(std::unique_ptr<Index> newIndex);
+
+    // Replace the sampler (uniform by default); call before start()
+    void setSampler(std::unique_ptr<PointSampler> newSampler) { sampler = std::move(newSampler); }
+    const PointSampler& getSampler() const { return *sampler; }
+
+    // Select the growth strategy; call before start()
+    void setMode(PlannerMode newMode);
+    PlannerMode getMode() const { return mode; }
+
+    // Step size of this planner only, e.g. to race planners with different steps on one Setup;
+    // call before start()
+    void setStepSize(double size) { stepSize = size; }
+    double getStepSize() const { return stepSize; }
+
+    // Star mode stops once either budget is spent (zero disables it); with neither set it stops
+    // at the first path like the other modes. For start() and replan(); plan() takes its budgets
+    // from its options.
+    void setBudget(std::chrono::milliseconds time, std::size_t maxIterations = 0) {
+        timeBudget = time;
+        iterationBudget = maxIterations;
     }
-    std::unique_ptr<Node<T>> getRoot() { return std::move(root); }
+    // Cost of the best path found so far (infinity until there is one); safe to poll during start()
+    double getBestCost() const { return bestCost.load(); }
+    std::size_t iterationCount() const { return iterations.load(); }
+    // Totals of the finished run; valid once start() has returned
+    const PlannerStats& getStats() const { return stats; }
+    const PhaseMetrics& getMetrics() const { return metrics; }
+    // Seconds from start() until the first path was found; 0 if none was found
+    double getTimeToFirstPath() const { return std::chrono::duration<double>(firstPathTime).count(); }
 
     // Nearest neighbor search
-    Node<T>* findNearest(const Point<T>& randomPoint, Node<T>* currentNode, double& minDistance);
+    NodeId findNearest(const Point<T>& randomPoint, double& minDistance);
 
-    // Function to sample random points
-    Point<T> samplePoint();
+    // All tree nodes within 'radius' of a point
+    std::vector<NodeId> findNear(const Point<T>& point, double radius);
+
+    // Next sample from the calling thread's stream
+    Point<T> samplePoint(Stream& stream);
 
     // Check if the path between two points is clear
     bool collision_avoidance_check(Point<T>& randomPoint, const Point<T>& nearestPoint);
 
     // Add a new node to the tree
-    void addNode(Node<T>* nearestNode, const Point<T>& newPoint);  // Ensure this is public
+    NodeId addNode(NodeId nearestNode, const Point<T>& newPoint);
 
     // Main RRT loop for the thread
     void run(int thread_id);
+    // RRT-Connect loop for the thread; threads start on alternating trees
+    void runConnect(int thread_id, Stream& stream, PlannerStats& local);
+    // Anytime RRT* loop for the thread
+    void runStar(int thread_id, Stream& stream, PlannerStats& local);
+    // Lazy RRT loop for the thread
+    void runLazy(int thread_id, Stream& stream, PlannerStats& local);
     std::vector<Point<T>> getShortestPath();
-    // Start the RRT planner with multiple threads
+    // Start the RRT planner with multiple threads; returns once there is a path (Star mode: once
+    // the budget is spent) or cancel() is called
     void start(int num_threads);
+    // Plan within a time and node budget, stopping early on the stop token; reports why it
+    // returned and, without a path, how close the tree got. Trees are kept, so calling plan()
+    // again after a Timeout resumes it; outside Star mode an existing path returns at once, and
+    // in Star mode a second call keeps improving the path for its own budget.
+    PlanOutcome<Point<T>> plan(const PlanOptions& options);
+    // Pick lists: grow the start tree until it reaches every pick, instead of planning each leg
+    // from scratch, and return the legs between all pairs of stops (the start is stop 0) with a
+    // visiting order by their costs. RRT mode only; budgets, the stop token and progress work as
+    // for plan(), the memory bound does not apply. The tree is kept, so a later call with other
+    // picks starts from it.
+    PickListOutcome<Point<T>> planStops(const std::vector<Point<T>>& picks, const PlanOptions& options);
+
+    // Change obstacles while the planner keeps its trees (between runs, not during start()).
+    // The arena is updated and only the tree edges within reach of the changed cells are
+    // checked again; nodes cut off by a blocked edge are reattached to their cheapest free
+    // neighbour, RRTX style, or leave the tree. The best path is kept if it avoided the change.
+    // Freed space is not reconnected here: replan() regrows into it. 2D arenas only.
+    RepairStats addObstacles(const ObstacleBatch& batch);
+    RepairStats removeObstacles(const ObstacleBatch& batch);
+    // Grow the repaired trees until there is a path again (Star mode: for a fresh budget);
+    // returns at once in the other modes if the path survived the change
+    void replan(int num_threads);
+
+    // Make start() return as soon as the workers notice; safe to call from any thread. The best
+    // path found so far is kept. A planner cancelled before start() returns from it at once.
+    void cancel() { finish(); }
 
 private:  // If you have private members or helper functions, declare them here
-    double calculateDistance(const Point<T>& p1, const Point<T>& p2) {
-        return std::sqrt(std::pow(p1.getX() - p2.getX(), 2) + std::pow(p1.getY() - p2.getY(), 2));
+    // Lock-free grid index on the floor; 3D arenas use a k-d tree over x, y and z
+    std::unique_ptr<Index> makeIndex() const {
+        if (setup.is3D()) return std::make_unique<KdTreeIndex<Point<T>, NodeId, 3>>();
+        return std::make_unique<GridIndex<Point<T>, NodeId>>(setup.length, setup.width, setup.step_size);
     }
-};
-
 
-// Function to visualize the RRT tree, obstacles, and the start and target points
-
-// Function to visualize the RRT tree, obstacles, and the start and target points
-template <typename T>
-void visualize(const Setup<T>& setup, const Node<T>* root, const std::vector<Point<T>>& path) {
-    // Create a window for visualization
-    sf::RenderWindow window(sf::VideoMode(setup.length, setup.width), "RRT Tree and Path Visualization");
-
-    // Define colors
-    sf::Color obstacleColor = sf::Color(101, 67, 33);   // Dark Brown for obstacles
-    sf::Color nodeColor = sf::Color(0, 128, 128);       // Dark Teal for nodes
-    sf::Color lineColor = sf::Color(0, 102, 102);       // Slightly lighter Teal for lines between nodes
-    sf::Color startEndColor = sf::Color(50, 50, 50);    // Dark Gray for start and end points
-    sf::Color pathColor = sf::Color::Black;             // Black for the path
-
-    // Set path thickness
-    float pathThickness = 6.0f;  // Increase this to make the path more prominent
-
-    // Run the visualization loop
-    while (window.isOpen()) {
-        sf::Event event;
-        while (window.pollEvent(event)) {
-            if (event.type == sf::Event::Closed)
-                window.close();
+    // Is the straight edge a->b free for the robot, in the grid or the voxel map?
+    bool edgeFree(const Point<T>& a, const Point<T>& b) const {
+        if (volume) {
+            double inv = 1.0 / setup.dim;
+            return volume->segmentFree(a.getX() * inv, a.getY() * inv, a.getZ() * inv, b.getX() * inv, b.getY() * inv, b.getZ() * inv);
         }
+        return checker.segmentFree(a.getX(), a.getY(), b.getX(), b.getY());
+    }
 
-        window.clear(sf::Color::White);  // Clear with white background
-
-        // Draw obstacles (as brown rectangles)
-        for (int i = 0; i < setup.arena.size(); ++i) {
-            for (int j = 0; j < setup.arena[0].size(); ++j) {
-                if (setup.arena[i][j] == -1) {
-                    sf::RectangleShape obstacle(sf::Vector2f(setup.dim, setup.dim));
-                    obstacle.setPosition(j * setup.dim, i * setup.dim);
-                    obstacle.setFillColor(obstacleColor);
-                    window.draw(obstacle);
-                }
-            }
+    // Cut the edge nearest->point down to the step size; false if the points coincide
+    bool steer(Point<T>& point, const Point<T>& nearestPoint) const;
+    // Can the robot stand on the point (cell or voxel free)? The only check a lazy edge gets up front
+    bool pointFree(const Point<T>& p) const {
+        if (volume) {
+            double inv = 1.0 / setup.dim;
+            int x = static_cast<int>(p.getX() * inv), y = static_cast<int>(p.getY() * inv), z = static_cast<int>(p.getZ() * inv);
+            return volume->inBounds(x, y, z) && !volume->isOccupied(x, y, z);
         }
+        return checker.pointFree(p.getX(), p.getY());
+    }
 
-        // Function to recursively draw the nodes and lines
-        std::function<void(const Node<T>*)> drawTree = [&](const Node<T>* node) {
-            if (!node) return;
-
-            // Draw a small black dot for the node
-            sf::CircleShape nodeDot(setup.dim / 4);
-            nodeDot.setPosition(node->getPoint().getX(), node->getPoint().getY());
-            nodeDot.setFillColor(nodeColor);
-            window.draw(nodeDot);
-
-            // Draw a line from the parent to the current node (if not root)
-            if (node->getParent()) {
-                sf::Vertex line[] = {
-                    sf::Vertex(sf::Vector2f(node->getParent()->getPoint().getX(), node->getParent()->getPoint().getY()), lineColor),
-                    sf::Vertex(sf::Vector2f(node->getPoint().getX(), node->getPoint().getY()), lineColor)
-                };
-                window.draw(line, 2, sf::Lines);
-            }
+    NodeId nearestIn(const Index& idx, const Point<T>& point, double& minDistance);
+    NodeId addTo(TreeStore<T>& store, Index& idx, NodeId parent, const Point<T>& newPoint);
+    // addTo() for a caller that holds treeMutex
+    NodeId addLocked(TreeStore<T>& store, Index& idx, NodeId parent, const Point<T>& newPoint);
+
+    // Grow 'store' from its nearest node towards 'point' until it reaches it or is blocked;
+    // on success 'reached' is the node sitting on 'point'
+    bool connect(TreeStore<T>& store, Index& idx, const Point<T>& point, NodeId& reached, PlannerStats& local);
+
+    // RRT* insert: pick the cheapest collision-free parent among the nodes near 'newPoint',
+    // then rewire those neighbours through the new node where that lowers their cost
+    NodeId addStar(NodeId nearestNode, const Point<T>& newPoint, PlannerStats& local);
+    // Shift the cost of every node below 'root' by 'delta'; caller holds treeMutex
+    void propagateCost(NodeId root, double delta);
+    // Apply an obstacle change and repair both trees around it
+    RepairStats applyChange(const ObstacleBatch& batch, bool remove);
+    // Check the edges of 'store' that may cross the cell window again, then reattach or drop
+    // the nodes below the blocked ones; caller holds treeMutex
+    void repairTree(TreeStore<T>& store, Index& idx, int x0, int y0, int x1, int y1, RepairStats& repair);
+    // Pick the best surviving path after a repair; caller holds treeMutex
+    void revalidatePath(RepairStats& repair);
+    static std::uint64_t edgeKey(NodeId parent, NodeId child) { return static_cast<std::uint64_t>(parent) << 32 | child; }
+    // Lazy mode: check the unchecked edges from the root down to 'goal', repairing each one that
+    // fails, until the whole path is free (true) or 'goal' was cut off. Called with 'lock' on
+    // treeMutex held; the edges are checked with it released, and it is held again on return.
+    bool validatePath(NodeId goal, std::unique_lock<std::mutex>& lock, PlannerStats& local);
+    // Lazy mode: the edge into 'child' is blocked. Hang 'child' (with its subtree) under its
+    // cheapest neighbour, unchecked, or drop it and repair its children the same way; caller
+    // holds treeMutex
+    void repairLazyEdge(NodeId child, PlannerStats& local);
+    // Still connected to its root: dropped nodes stay in the store without a parent
+    static bool attached(const TreeStore<T>& store, NodeId id) { return id == 0 || store.parent(id) != kNoNode; }
+    // Longest edge either tree can hold (integer coordinates round a steered point by up to a unit per axis)
+    double maxEdgeLength() const { return stepSize + 2.0; }
+
+    // Neighbourhood radius gamma * sqrt(log n / n), capped at step_size
+    double rewireRadius(std::size_t n) const;
+    bool budgetSpent() const;
+
+    // plan()'s wait: until targetReached, the deadline or a stop, reporting progress meanwhile
+    void waitForPlan(std::unique_lock<std::mutex>& lock, const PlanOptions& options, std::chrono::steady_clock::time_point begin,
+                     std::chrono::steady_clock::time_point deadline);
+    // Launch the workers, let 'wait' block (holding treeMutex) until targetReached, join and log;
+    // 'resume' keeps the run's clock (for the time to first path and the Star budget)
+    void runWorkers(int num_threads, const std::function<void(std::unique_lock<std::mutex>&)>& wait, bool resume = false);
+    std::size_t slotsUsed() const { return tree.size() + (goalIndex ? goalTree.size() : 0); }
+    // Most memoryBytes() can grow by before the next check; caller holds treeMutex
+    std::size_t growthBytes() const {
+        std::size_t bytes = tree.growthBytes() + index->growthBytes();
+        if (goalIndex) bytes += goalTree.growthBytes() + goalIndex->growthBytes();
+        return bytes;
+    }
+    // Prune both trees to 'keep' live nodes, leaves with the highest cost to come plus distance to
+    // go first, keeping the best path; their slots are reused and the indexes rebuilt. Workers
+    // must be stopped. Returns the nodes pruned.
+    std::size_t prune(std::size_t keep);
+    std::size_t pruneStore(TreeStore<T>& store, Index& idx, const Point<T>& towards, NodeId protect, std::size_t remove);
+    // Bookkeeping after a node joined 'store': the closest node, the node budget and the memory
+    // bound; caller holds treeMutex
+    void nodeAdded(const TreeStore<T>& store, NodeId id);
+    // Cheap check that a plan can succeed at all: the start is inside the arena and a node can land
+    // near the target (a cell within two of the target's is free; the target itself may be blocked)
+    bool endpointsUsable() const { return startUsable() && targetUsable(setup.target); }
+    bool startUsable() const;
+    bool targetUsable(const Point<T>& target) const;
+    // Is a cell near the target 8-connected to the start through cells free for the robot? If not,
+    // no planner can reach the target. One pass over the free cells; 2D arenas only (true in 3D)
+    bool targetReachable() const { return targetReachable(setup.target); }
+    bool targetReachable(const Point<T>& target) const;
+
+    // Hand a finished thread's sampler tallies, stats and phase timings over to the planner
+    void retire(Stream& stream, const PlannerStats& local, const PhaseMetrics& localMetrics);
+
+    // Take treeMutex, recording the wait as Phase::LockWait
+    std::unique_lock<std::mutex> lockTree() {
+        PhaseTimer timer(Phase::LockWait);
+        return std::unique_lock<std::mutex>(treeMutex);
+    }
 
-            // Recursively draw all the children of the current node
-            for (const auto& child : node->getChildren()) {
-                drawTree(child.get());
-            }
-        };
+    // Note the time of the first path; caller holds treeMutex
+    void recordFirstPath() {
+        if (firstPathTime.count() == 0) firstPathTime = std::chrono::steady_clock::now() - startTime;
+    }
 
-        // Start drawing the tree from the root node
-        drawTree(root);
-
-        // Draw the start point as a red dot
-        sf::CircleShape startDot(setup.dim / 2);
-        startDot.setPosition(setup.start.getX(), setup.start.getY());
-        startDot.setFillColor(startEndColor);
-        window.draw(startDot);
-
-        // Draw the target point as a red dot
-        sf::CircleShape targetDot(setup.dim / 2);
-        targetDot.setPosition(setup.target.getX(), setup.target.getY());
-        targetDot.setFillColor(startEndColor);
-        window.draw(targetDot);
-
-        // Draw the shortest path as a thick black line
-        if (!path.empty()) {
-            for (size_t i = 1; i < path.size(); ++i) {
-                // Calculate the direction and length of the segment
-                sf::Vector2f start(path[i - 1].getX(), path[i - 1].getY());
-                sf::Vector2f end(path[i].getX(), path[i].getY());
-                sf::Vector2f direction = end - start;
-
-                // Calculate the angle of rotation
-                float length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
-                float angle = std::atan2(direction.y, direction.x) * 180 / 3.14159f;
-
-                // Create a rectangle to represent the thick line
-                sf::RectangleShape pathSegment(sf::Vector2f(length, pathThickness));
-                pathSegment.setPosition(start);
-                pathSegment.setRotation(angle);
-                pathSegment.setFillColor(pathColor);
-
-                window.draw(pathSegment);
-            }
+    // Wake start() and make every worker leave its loop
+    void finish() {
+        std::unique_lock<std::mutex> lock(treeMutex);
+        targetReached = true;
+        cv.notify_all();
+    }
+
+    // Integral coordinates round to the nearest cell unit; truncating pulled every steered
+    // point towards the origin. Float planners keep the fraction (sub-cell precision).
+    static T toCoordinate(double v) {
+        if constexpr (std::is_integral_v<T>) return static_cast<T>(std::lround(v));
+        else return static_cast<T>(v);
+    }
+
+    // z is 0 for every point of a 2D arena. Comparisons against a radius use the squared
+    // distance and skip the square root.
+    static double squaredDistance(const Point<T>& p1, const Point<T>& p2) {
+        double dx = static_cast<double>(p1.getX()) - p2.getX();
+        double dy = static_cast<double>(p1.getY()) - p2.getY();
+        double dz = static_cast<double>(p1.getZ()) - p2.getZ();
+        return dx * dx + dy * dy + dz * dz;
+    }
+    static double calculateDistance(const Point<T>& p1, const Point<T>& p2) {
+        return std::sqrt(squaredDistance(p1, p2));
+    }
+    // Within the target tolerance of 1.5 cells
+    bool nearTarget(const Point<T>& p) const { return nearGoal(p, setup.target); }
+    bool nearGoal(const Point<T>& p, const Point<T>& goal) const {
+        double tolerance = setup.dim * 1.5;
+        return squaredDistance(p, goal) < tolerance * tolerance;
+    }
+};
+
+
+// Convert an occupancy image into a .rrtmap file. PGM images are streamed band by band; other
+// formats SFML can decode (PNG, BMP, TGA, JPEG) are loaded whole. A pixel is an obstacle when
+// its luminance is below occupiedBelow (0-255); image row r becomes grid row r.
+inline bool importOccupancyImage(const std::string& imagePath, const std::string& mapPath, double cellSize, int occupiedBelow = 128) {
+    std::string extension = imagePath.substr(std::min(imagePath.size(), imagePath.rfind('.')));
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    if (extension == ".pgm") {
+        std::string error;
+        if (!importPgm(imagePath, mapPath, cellSize, occupiedBelow, error)) {
+            logger->error("Map import failed: {}", error);
+            return false;
         }
+        logger->info("Imported {} into {}", imagePath, mapPath);
+        return true;
+    }
 
-        window.display();  // Display everything on the screen
+    sf::Image image;
+    if (!image.loadFromFile(imagePath)) {
+        logger->error("Map import failed: cannot decode {}", imagePath);
+        return false;
+    }
+    int cols = static_cast<int>(image.getSize().x), rows = static_cast<int>(image.getSize().y);
+    const sf::Uint8* rgba = image.getPixelsPtr();
+    TiledMapWriter writer(mapPath, cols, rows, cellSize);
+    std::vector<std::uint8_t> row(cols);
+    for (int y = 0; y < rows && writer.good(); ++y) {
+        for (int x = 0; x < cols; ++x) {
+            const sf::Uint8* p = rgba + 4 * (static_cast<std::size_t>(y) * cols + x);
+            row[x] = 299 * p[0] + 587 * p[1] + 114 * p[2] < 1000 * occupiedBelow;
+        }
+        writer.addRow(row.data());
     }
+    if (!writer.finish()) {
+        logger->error("Map import failed: cannot write {}", mapPath);
+        return false;
+    }
+    logger->info("Imported {}x{} image {} into {}", cols, rows, imagePath, mapPath);
+    return true;
 }
 
 std::string generateLogFileName() {
@@ -316,7 +657,10 @@ std::string generateLogFileName() {
 
 void setupLogger() {
     std::string logFileName = generateLogFileName();
-    logger = spdlog::basic_logger_mt("file_logger", logFileName);
+    // Bounded queue drained by one writer thread; when it is full the oldest message is dropped,
+    // so planner threads never wait on disk I/O
+    spdlog::init_thread_pool(8192, 1);
+    logger = spdlog::basic_logger_mt<spdlog::async_factory_nonblock>("file_logger", logFileName);
     logger->set_level(spdlog::level::info);
     spdlog::set_default_logger(logger); // Set as default to easily use spdlog::info, etc.
 
@@ -371,4 +715,24 @@ void addWarehouseObstacles(Setup<T>& setup, int width, int height) {
     for (const auto& obstacle : obstacles) {
         setup.addObstacle(obstacle);
     }
-}
\ No newline at end of file
+}
+// 3D warehouse for arenas built with a height: the shelves of addWarehouseObstacles become racks
+// reaching 80% of the ceiling, and a wall across the middle of the floor, 60% of the ceiling
+// high, can only be crossed by flying over it.
+template <typename T>
+void addWarehouseRacks(Setup<T>& setup, int width, int height, int ceiling) {
+    int shelfWidth = width / 5;
+    int shelfHeight = height / 10;
+    int spaceBetweenShelves = height / 10;
+    int rackTop = ceiling * 8 / 10;
+
+    for (int x1 : {shelfWidth, width - 2 * shelfWidth}) {
+        for (int i = 0; i < 4; i++) {
+            int y1 = (i * (shelfHeight + spaceBetweenShelves)) + spaceBetweenShelves;
+            setup.addBox(Point<T>(x1, y1, 0), Point<T>(x1 + shelfWidth, y1 + shelfHeight, rackTop));
+        }
+    }
+
+    int wallY = height / 2 - spaceBetweenShelves / 2;
+    setup.addBox(Point<T>(0, wallY, 0), Point<T>(width, wallY + setup.dim, ceiling * 6 / 10));
+}
@@ -0,0 +1,818 @@
+#include "arena_definitions.cpp"
+#include "planning_service.h"
+#include "path_smoother.h"
+#include "planner_portfolio.h"
+#include "snapshot_renderer.h"
+#include <benchmark/benchmark.h>
+#include <spdlog/sinks/null_sink.h>
+#include <fstream>
+#include <unistd.h>
+
+// Seeds are cycled from a fixed set so every run of the suite plans the same problems
+static unsigned benchSeed(int64_t iteration) { return 1 + static_cast<unsigned>(iteration % 16); }
+
+// Registers 1..N worker threads, N = hardware concurrency
+static void threadCounts(benchmark::internal::Benchmark* b) {
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    for (int threads = 1; threads <= maxThreads; ++threads) {
+        b->Arg(threads);
+    }
+}
+
+// End-to-end scenarios; all of them are square maps with a 10x10 robot and step size 50
+enum Scenario { Warehouse, RandomClutter, NarrowPassage };
+
+static const char* scenarioName(int scenario) {
+    switch (scenario) {
+    case RandomClutter: return "clutter";
+    case NarrowPassage: return "narrow";
+    default: return "warehouse";
+    }
+}
+
+static void addRect(Setup<int>& setup, int x0, int y0, int x1, int y1) {
+    setup.addObstacle({Point<int>(x0, y0), Point<int>(x1, y0), Point<int>(x1, y1), Point<int>(x0, y1)});
+}
+
+// Builds the map for a scenario; obstacles are generated from a fixed seed so every run is identical
+static std::unique_ptr<Setup<int>> makeScenario(int scenario, int size) {
+    auto setup = std::make_unique<Setup<int>>(10, 10, size, size, Point<int>(10, 10), Point<int>(size - 50, size - 50), 50);
+    if (scenario == Warehouse) {
+        addWarehouseObstacles(*setup, size, size);
+    } else if (scenario == RandomClutter) {
+        // Rectangular blocks, kept away from the start and target corners, until ~30% of the map
+        // is blocked once grown by the robot footprint (which the collision checker adds)
+        std::mt19937 gen(42);
+        std::uniform_int_distribution<> pos(0, size - 1), side(size / 50, size / 20);
+        int blocks = 0;
+        for (double covered = 0; covered < 0.30 * size * size && blocks < 10000; ++blocks) {
+            int x = pos(gen), y = pos(gen), w = side(gen), h = side(gen);
+            if ((x < 150 && y < 150) || (x + w > size - 150 && y + h > size - 150)) continue;
+            addRect(*setup, x, y, std::min(x + w, size - 1), std::min(y + h, size - 1));
+            covered += static_cast<double>(w + 20) * (h + 20);
+        }
+    } else {
+        // A full-height wall across the middle with one passage 6 cells wide
+        int wall = size / 2, gap = size / 2;
+        addRect(*setup, wall, 0, wall + 20, gap - 30);
+        addRect(*setup, wall, gap + 30, wall + 20, size - 1);
+    }
+    return setup;
+}
+
+static double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0;
+    std::sort(values.begin(), values.end());
+    std::size_t rank = static_cast<std::size_t>(std::ceil(p * values.size()));
+    return values[std::max<std::size_t>(rank, 1) - 1];
+}
+
+// Scenario x map size x thread count x mode (0 RRT, 1 Connect)
+static void scenarioArgs(benchmark::internal::Benchmark* b) {
+    int maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<int64_t> threads = {1};
+    if (maxThreads > 1) threads.push_back(maxThreads);
+    for (int scenario : {Warehouse, RandomClutter, NarrowPassage}) {
+        for (int size : {500, 1000, 2000}) {
+            for (int64_t t : threads) {
+                for (int mode : {0, 1}) {
+                    b->Args({scenario, size, t, mode});
+                }
+            }
+        }
+    }
+}
+
+// Time to first path. Each iteration plans one problem with seed 1, 2, ..., so the distribution
+// over a fixed number of iterations is reproducible; p50/p99 are reported as counters.
+static constexpr int kPlansPerScenario = 24;
+
+static void BM_TimeToPath(benchmark::State& state) {
+    int scenario = static_cast<int>(state.range(0));
+    int size = static_cast<int>(state.range(1));
+    int threads = static_cast<int>(state.range(2));
+    PlannerMode mode = state.range(3) ? PlannerMode::Connect : PlannerMode::RRT;
+    unsigned seed = 1;
+    int64_t nodes = 0;
+    std::vector<double> times;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(scenario, size);
+        RRTPlanner<int> rrt(*setup, seed++);
+        rrt.setMode(mode);
+        state.ResumeTiming();
+
+        auto begin = std::chrono::steady_clock::now();
+        rrt.start(threads);
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        nodes += rrt.nodeCount();
+    }
+    state.SetLabel(std::string(scenarioName(scenario)) + (mode == PlannerMode::Connect ? "/connect" : "/rrt"));
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kAvgIterations);
+    state.counters["nodes_per_s"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+    state.counters["p50_ms"] = percentile(times, 0.50);
+    state.counters["p99_ms"] = percentile(times, 0.99);
+}
+BENCHMARK(BM_TimeToPath)->Apply(scenarioArgs)->Iterations(kPlansPerScenario)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Time to path in the 3D racking warehouse (1000 x 1000 x 300), which needs a path over the
+// middle wall. range(0) is the voxel size: smaller voxels grow a dense grid with the cube of the
+// resolution, the sparse map only with the obstacle surface; both sizes are reported.
+static void BM_TimeToPath3D(benchmark::State& state) {
+    int voxel = static_cast<int>(state.range(0));
+    PlannerMode mode = state.range(1) ? PlannerMode::Connect : PlannerMode::RRT;
+    unsigned seed = 1;
+    int64_t nodes = 0;
+    std::size_t mapBytes = 0, denseBytes = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Setup<int> setup(voxel, voxel, voxel, 1000, 1000, 300, Point<int>(10, 10, 10), Point<int>(950, 950, 10), 50);
+        addWarehouseRacks(setup, 1000, 1000, 300);
+        mapBytes = setup.volume->memoryBytes();
+        denseBytes = static_cast<std::size_t>(setup.volume->sizeX()) * setup.volume->sizeY() * setup.volume->sizeZ() / 8;
+        RRTPlanner<int> rrt(setup, seed++);
+        rrt.setMode(mode);
+        state.ResumeTiming();
+
+        rrt.start(1);
+        nodes += rrt.nodeCount();
+    }
+    state.SetLabel(plannerModeName(mode));
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kAvgIterations);
+    state.counters["map_bytes"] = static_cast<double>(mapBytes);
+    state.counters["dense_bytes"] = static_cast<double>(denseBytes);
+}
+BENCHMARK(BM_TimeToPath3D)->ArgsProduct({{10, 2}, {1}})->Args({10, 0})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Bulk obstacle ingestion: 20000 rotated racks and 5000 round columns over a 10000 x 10000
+// facility (1000 x 1000 cells), rasterized on range(0) threads. Items are obstacles.
+static void BM_IngestObstacles(benchmark::State& state) {
+    int threads = static_cast<int>(state.range(0));
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<> coord(0, 10000), side(20, 200), angle(0, M_PI), radius(5, 30);
+    ObstacleBatch batch;
+    for (int i = 0; i < 20000; ++i) {
+        batch.addRotatedRect(coord(gen), coord(gen), side(gen), side(gen) / 4, angle(gen));
+    }
+    for (int i = 0; i < 5000; ++i) {
+        batch.addCircle(coord(gen), coord(gen), radius(gen));
+    }
+    Setup<int> setup(10, 10, 10000, 10000, Point<int>(10, 10), Point<int>(9950, 9950), 50);
+
+    std::size_t cells = 0;
+    for (auto _ : state) {
+        // Later iterations re-fill the same cells, which costs the same scan
+        cells = std::max(cells, setup.addObstacles(batch, threads).cellsMarked);
+    }
+    state.SetItemsProcessed(state.iterations() * batch.size());
+    state.counters["cells"] = static_cast<double>(cells);
+}
+BENCHMARK(BM_IngestObstacles)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Resident set size of this process, from /proc/self/statm (Linux)
+static double residentMiB() {
+    std::ifstream statm("/proc/self/statm");
+    long pages = 0, resident = 0;
+    statm >> pages >> resident;
+    return resident * static_cast<double>(sysconf(_SC_PAGESIZE)) / (1 << 20);
+}
+
+// Startup from a mapped .rrtmap site of 32768 x 32768 cells (10 units each, ~1 billion cells):
+// open the file, build the Setup and a collision checker, then check 1000 edges near the start.
+// The site (buildings on a 2000-cell pitch plus scattered posts) is written once per run.
+// Reports the time to the first checked edge and the memory the process gained.
+static void BM_MapStartup(benchmark::State& state) {
+    static const std::string path = "/tmp/rrt_bench_site.rrtmap";
+    static bool written = [] {
+        int n = 32768;
+        TiledMapWriter writer(path, n, n, 10);
+        std::vector<std::uint8_t> row(n);
+        for (int y = 0; y < n; ++y) {
+            for (int x = 0; x < n; ++x) {
+                bool building = x % 2000 >= 600 && x % 2000 < 1400 && y % 2000 >= 300 && y % 2000 < 1700;
+                row[x] = building || (x % 97 == 0 && y % 89 < 3);
+            }
+            writer.addRow(row.data());
+        }
+        return writer.finish();
+    }();
+    if (!written) {
+        state.SkipWithError("cannot write the benchmark site");
+        return;
+    }
+
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<> coord(0, 5000), delta(-50, 50);
+    double gained = 0;
+    std::size_t tiles = 0;
+    for (auto _ : state) {
+        double before = residentMiB();
+        std::string error;
+        Setup<int> setup(10, 10, TiledMapFile::open(path, error), Point<int>(10, 10), Point<int>(4950, 4950), 50);
+        CollisionChecker checker(setup.clearance, setup.dim, setup.footprintRadius());
+        int free = 0;
+        for (int i = 0; i < 1000; ++i) {
+            double x = coord(gen), y = coord(gen);
+            free += checker.segmentFree(x, y, x + delta(gen), y + delta(gen));
+        }
+        benchmark::DoNotOptimize(free);
+        gained += residentMiB() - before;
+        tiles = checker.filledTiles();
+    }
+    state.counters["resident_MiB"] = gained / state.iterations();
+    state.counters["tiles_touched"] = static_cast<double>(tiles);
+}
+BENCHMARK(BM_MapStartup)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Replanning after a pallet (a 40-unit disc) lands on the middle of the current path in the
+// 1000 x 1000 warehouse. range(0) is the mode (0 RRT, 2 RRT* with a 20000-iteration budget and
+// 5000 more to recover); range(1) 0 repairs the live tree and replans, 1 plans from scratch on the
+// changed map. The timed region is the change plus planning until there is a path again.
+static void BM_Replan(benchmark::State& state) {
+    PlannerMode mode = state.range(0) == 2 ? PlannerMode::Star : PlannerMode::RRT;
+    bool scratch = state.range(1) != 0;
+    unsigned seed = 1;
+    std::vector<double> times;
+    std::uint64_t orphaned = 0, dropped = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(Warehouse, 1000);
+        auto rrt = std::make_unique<RRTPlanner<int>>(*setup, seed);
+        rrt->setMode(mode);
+        if (mode == PlannerMode::Star) rrt->setBudget(std::chrono::milliseconds(0), 20000);
+        rrt->start(1);
+        std::vector<Point<int>> path = rrt->getShortestPath();
+        ObstacleBatch pallet;
+        pallet.addCircle(path[path.size() / 2].getX(), path[path.size() / 2].getY(), 40);
+        state.ResumeTiming();
+
+        auto begin = std::chrono::steady_clock::now();
+        if (scratch) {
+            setup->addObstacles(pallet, 1);
+            rrt = std::make_unique<RRTPlanner<int>>(*setup, seed);
+            rrt->setMode(mode);
+            if (mode == PlannerMode::Star) rrt->setBudget(std::chrono::milliseconds(0), 20000);
+            rrt->start(1);
+        } else {
+            RepairStats repair = rrt->addObstacles(pallet);
+            orphaned += repair.orphaned;
+            dropped += repair.dropped;
+            if (mode == PlannerMode::Star) rrt->setBudget(std::chrono::milliseconds(0), 5000);
+            rrt->replan(1);
+        }
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        ++seed;
+    }
+    state.SetLabel(std::string(mode == PlannerMode::Star ? "star" : "rrt") + (scratch ? "/scratch" : "/repair"));
+    state.counters["orphaned"] = benchmark::Counter(static_cast<double>(orphaned), benchmark::Counter::kAvgIterations);
+    state.counters["dropped"] = benchmark::Counter(static_cast<double>(dropped), benchmark::Counter::kAvgIterations);
+    state.counters["p50_ms"] = percentile(times, 0.50);
+    state.counters["p99_ms"] = percentile(times, 0.99);
+}
+BENCHMARK(BM_Replan)->ArgsProduct({{0, 2}, {0, 1}})->Iterations(12)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Post-processing a long raw path: the RRT path across the 4000 x 4000 warehouse, split into 20
+// jittered waypoints per edge (about 3000 waypoints). range(0) threads, range(1) 1 adds the spline.
+static void BM_SmoothPath(benchmark::State& state) {
+    static std::unique_ptr<Setup<int>> setup = makeScenario(Warehouse, 4000);
+    static std::unique_ptr<RRTPlanner<int>> rrt;
+    static std::vector<Point<int>> path;
+    if (!rrt) {
+        rrt = std::make_unique<RRTPlanner<int>>(*setup, 3);
+        rrt->start(1);
+        std::vector<Point<int>> raw = rrt->getShortestPath();
+        const CollisionChecker& checker = rrt->getCollisionChecker();
+        std::mt19937 gen(1);
+        std::uniform_int_distribution<> jitter(-6, 6);
+        path.push_back(raw.front());
+        for (std::size_t i = 1; i < raw.size(); ++i) {
+            for (int k = 1; k <= 20; ++k) {
+                const Point<int>& a = raw[i - 1];
+                Point<int> q(a.getX() + k * (raw[i].getX() - a.getX()) / 20, a.getY() + k * (raw[i].getY() - a.getY()) / 20);
+                if (k < 20) q = Point<int>(q.getX() + jitter(gen), q.getY() + jitter(gen));
+                if (!checker.segmentFree(path.back().getX(), path.back().getY(), q.getX(), q.getY())) q = raw[i];
+                path.push_back(q);
+            }
+        }
+    }
+
+    SmoothingOptions options;
+    options.threads = static_cast<int>(state.range(0));
+    options.spline = state.range(1) != 0;
+    SmoothingReport report;
+    for (auto _ : state) {
+        PathSmoother<Point<int>> smoother(rrt->getCollisionChecker(), setup->dim, options);
+        benchmark::DoNotOptimize(smoother.smooth(path, report));
+    }
+    state.counters["waypoints_in"] = static_cast<double>(report.waypointsBefore);
+    state.counters["waypoints_out"] = static_cast<double>(report.waypointsAfter);
+    state.counters["length_in"] = report.lengthBefore;
+    state.counters["length_out"] = report.lengthAfter;
+    state.counters["edges_checked"] = static_cast<double>(report.edgesChecked);
+}
+BENCHMARK(BM_SmoothPath)->ArgsProduct({{1, 4}, {0, 1}})->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Time to first path of a portfolio racing range(1) planners, one pool thread each, on the
+// 2000 x 2000 map of scenario range(0); 1 is a single RRT planner. Seeds advance by the portfolio
+// size per iteration so no two iterations share a planner. Compare p50/p99 with the single run.
+static void BM_Portfolio(benchmark::State& state) {
+    int scenario = static_cast<int>(state.range(0));
+    int planners = static_cast<int>(state.range(1));
+    unsigned seed = 1;
+    std::vector<double> times;
+    int64_t started = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(scenario, 2000);
+        PortfolioOptions options;
+        options.planners = planners;
+        options.threads = planners;
+        options.seed = seed;
+        seed += planners;
+        state.ResumeTiming();
+
+        auto begin = std::chrono::steady_clock::now();
+        PortfolioResult<int> result = PlannerPortfolio<int>(*setup, options).run();
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        started += result.started;
+    }
+    state.SetLabel(scenarioName(scenario));
+    state.counters["started"] = benchmark::Counter(static_cast<double>(started), benchmark::Counter::kAvgIterations);
+    state.counters["p50_ms"] = percentile(times, 0.50);
+    state.counters["p99_ms"] = percentile(times, 0.99);
+}
+BENCHMARK(BM_Portfolio)->ArgsProduct({{RandomClutter, NarrowPassage}, {1, 4, 10}})->Iterations(kPlansPerScenario)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Latency of plan() on the 1000 x 1000 warehouse with the target fenced off, so no path exists.
+// range(0) is the time budget in ms; range(1) 1 sets proveInfeasible, which answers Infeasible
+// after one flood fill instead of spending the budget. p99_over_ms is the latency past the budget.
+static void BM_PlanBudget(benchmark::State& state) {
+    int budget = static_cast<int>(state.range(0));
+    bool prove = state.range(1) != 0;
+    unsigned seed = 1;
+    std::vector<double> times;
+    int64_t infeasible = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(Warehouse, 1000);
+        addRect(*setup, 880, 880, 999, 890);
+        addRect(*setup, 880, 880, 890, 999);
+        RRTPlanner<int> rrt(*setup, seed++);
+        PlanOptions options;
+        options.timeBudget = std::chrono::milliseconds(budget);
+        options.proveInfeasible = prove;
+        state.ResumeTiming();
+
+        auto begin = std::chrono::steady_clock::now();
+        PlanOutcome<Point<int>> outcome = rrt.plan(options);
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        infeasible += outcome.status == PlanStatus::Infeasible;
+    }
+    state.SetLabel(prove ? "prove" : "budget");
+    state.counters["infeasible"] = benchmark::Counter(static_cast<double>(infeasible), benchmark::Counter::kAvgIterations);
+    state.counters["p50_ms"] = percentile(times, 0.50);
+    state.counters["p99_ms"] = percentile(times, 0.99);
+    state.counters["p99_over_ms"] = std::max(0.0, percentile(times, 0.99) - budget);
+}
+BENCHMARK(BM_PlanBudget)->ArgsProduct({{10, 50}, {0, 1}})->Iterations(kPlansPerScenario)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Inspecting a large tree: an RRT* tree of ~80k nodes on the 4000 x 4000 warehouse.
+// range(0) 0 captures a snapshot, 1 captures and saves it, 2 renders it at 2048 x 2048.
+static void BM_Snapshot(benchmark::State& state) {
+    static std::unique_ptr<Setup<int>> setup = makeScenario(Warehouse, 4000);
+    static std::unique_ptr<RRTPlanner<int>> rrt;
+    static std::vector<Point<int>> path;
+    if (!rrt) {
+        rrt = std::make_unique<RRTPlanner<int>>(*setup, 1);
+        rrt->setMode(PlannerMode::Star);
+        rrt->setBudget(std::chrono::milliseconds(0), 100000);
+        rrt->start(1);
+        path = rrt->getShortestPath();
+    }
+    std::string file = "bench_snapshot_" + std::to_string(getpid()) + ".rrtsnap", error;
+    TreeSnapshot snapshot = captureSnapshot(*setup, rrt->getTree(), path);
+    SnapshotRenderer renderer(snapshot);
+
+    for (auto _ : state) {
+        if (state.range(0) == 2) {
+            benchmark::DoNotOptimize(renderer.render());
+        } else {
+            snapshot = captureSnapshot(*setup, rrt->getTree(), path);
+            if (state.range(0) == 1) snapshot.save(file, error);
+        }
+    }
+    std::remove(file.c_str());
+    static const char* labels[] = {"capture", "capture+save", "render"};
+    state.SetLabel(labels[state.range(0)]);
+    state.counters["nodes"] = static_cast<double>(snapshot.nodeCount());
+}
+BENCHMARK(BM_Snapshot)->DenseRange(0, 2)->Unit(benchmark::kMillisecond);
+
+// Insert throughput on a large open floor, where runs are long enough for thread scaling to show
+static void BM_OpenFloorThroughput(benchmark::State& state) {
+    int threads = static_cast<int>(state.range(0));
+    int width = 3000, height = 3000, step_size = 50;
+    int64_t iteration = 0;
+    int64_t nodes = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Setup<int> setup(10, 10, width, height, Point<int>(10, 10), Point<int>(2950, 2950), step_size);
+        RRTPlanner<int> rrt(setup, benchSeed(iteration++));
+        state.ResumeTiming();
+
+        rrt.start(threads);
+        nodes += rrt.nodeCount();
+    }
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kAvgIterations);
+    state.counters["nodes_per_s"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kIsRate);
+}
+BENCHMARK(BM_OpenFloorThroughput)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// findNearest on a tree of range(0) random nodes; range(1) selects the index (0 grid, 1 kd-tree)
+static void BM_FindNearest(benchmark::State& state) {
+    int nodes = static_cast<int>(state.range(0));
+    Setup<int> setup(10, 10, 2000, 2000, Point<int>(10, 10), Point<int>(1950, 1950), 50);
+    RRTPlanner<int> rrt(setup, 1);
+    if (state.range(1)) {
+        rrt.setNearestIndex(std::make_unique<KdTreeIndex<Point<int>, NodeId>>());
+    }
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> coord(0, 1999);
+    for (int i = 1; i < nodes; ++i) {
+        rrt.addNode(0, Point<int>(coord(gen), coord(gen)));
+    }
+    std::vector<Point<int>> queries;
+    for (int i = 0; i < 1024; ++i) {
+        queries.emplace_back(coord(gen), coord(gen));
+    }
+
+    std::size_t q = 0;
+    for (auto _ : state) {
+        double minDistance = std::numeric_limits<double>::max();
+        benchmark::DoNotOptimize(rrt.findNearest(queries[q++ & 1023], minDistance));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_FindNearest)->ArgsProduct({{1000, 10000, 100000}, {0, 1}});
+
+// Steer-and-check of the planner (collision_avoidance_check) on the scenario maps
+static void BM_CollisionAvoidanceCheck(benchmark::State& state) {
+    auto setup = makeScenario(static_cast<int>(state.range(0)), 1000);
+    RRTPlanner<int> rrt(*setup, 1);
+    std::mt19937 gen(7);
+    std::uniform_int_distribution<> coord(0, 999);
+    std::vector<std::pair<Point<int>, Point<int>>> pairs;
+    for (int i = 0; i < 1024; ++i) {
+        pairs.emplace_back(Point<int>(coord(gen), coord(gen)), Point<int>(coord(gen), coord(gen)));
+    }
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        auto& pair = pairs[i++ & 1023];
+        Point<int> target = pair.second;
+        benchmark::DoNotOptimize(rrt.collision_avoidance_check(target, pair.first));
+    }
+    state.SetLabel(scenarioName(static_cast<int>(state.range(0))));
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_CollisionAvoidanceCheck)->DenseRange(Warehouse, NarrowPassage);
+
+// Rasterizing the warehouse shelves into a fresh arena of range(0) x range(0)
+static void BM_AddObstacle(benchmark::State& state) {
+    int size = static_cast<int>(state.range(0));
+    for (auto _ : state) {
+        state.PauseTiming();
+        Setup<int> setup(10, 10, size, size, Point<int>(10, 10), Point<int>(size - 50, size - 50), 50);
+        state.ResumeTiming();
+        addWarehouseObstacles(setup, size, size);
+        benchmark::DoNotOptimize(setup.arena);
+    }
+}
+BENCHMARK(BM_AddObstacle)->Arg(500)->Arg(1000)->Arg(2000)->Arg(4000);
+
+// Sampler selected by benchmark argument: 0 uniform, 1 goal-biased, 2 free-space, 3 Halton, 4 Sobol, 5 informed
+static std::unique_ptr<Sampler<Point<int>>> benchSampler(int kind, const Setup<int>& setup, const CollisionChecker& checker) {
+    using LowDiscrepancy = LowDiscrepancySampler<Point<int>>;
+    switch (kind) {
+    case 1: return std::make_unique<GoalBiasedSampler<Point<int>>>(setup.length, setup.width, setup.target);
+    case 2: return std::make_unique<FreeSpaceSampler<Point<int>>>(setup.length, setup.width, checker);
+    case 3: return std::make_unique<LowDiscrepancy>(setup.length, setup.width, LowDiscrepancy::Sequence::Halton);
+    case 4: return std::make_unique<LowDiscrepancy>(setup.length, setup.width, LowDiscrepancy::Sequence::Sobol);
+    case 5: return std::make_unique<InformedSampler<Point<int>>>(setup.length, setup.width, setup.start, setup.target);
+    default: return std::make_unique<UniformSampler<Point<int>>>(setup.length, setup.width);
+    }
+}
+
+// Single-threaded time to first path per sampler (RRT mode) or final cost after a fixed
+// iteration budget (Star mode), with the sampler's acceptance ratio
+static void BM_WarehouseSampler(benchmark::State& state) {
+    int kind = static_cast<int>(state.range(0));
+    PlannerMode mode = static_cast<PlannerMode>(state.range(1));
+    int width = 1000, height = 1000, step_size = 50;
+    int64_t iteration = 0;
+    double acceptance = 0, cost = 0;
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        Setup<int> setup(10, 10, width, height, Point<int>(10, 10), Point<int>(950, 950), step_size);
+        addWarehouseObstacles(setup, width, height);
+        RRTPlanner<int> rrt(setup, benchSeed(iteration++));
+        rrt.setMode(mode);
+        rrt.setBudget(std::chrono::milliseconds(0), mode == PlannerMode::Star ? 20000 : 0);
+        rrt.setSampler(benchSampler(kind, setup, rrt.getCollisionChecker()));
+        state.SetLabel(rrt.getSampler().name());
+        state.ResumeTiming();
+
+        rrt.start(1);
+        acceptance += rrt.getSampler().acceptanceRatio();
+        cost += rrt.getBestCost();
+    }
+    state.counters["accept_ratio"] = benchmark::Counter(acceptance, benchmark::Counter::kAvgIterations);
+    state.counters["cost"] = benchmark::Counter(cost, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_WarehouseSampler)
+    ->ArgsProduct({{0, 1, 2, 3, 4}, {static_cast<int>(PlannerMode::RRT)}})
+    ->ArgsProduct({{0, 5}, {static_cast<int>(PlannerMode::Star)}})
+    ->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Candidate edges of at most step_size length with random endpoints on the warehouse layout
+static EdgeBatch warehouseEdges(const Setup<int>& setup, std::size_t count, double length = 0) {
+    if (length == 0) length = setup.step_size;
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<> distX(0, setup.length), distY(0, setup.width), angle(0, 2 * M_PI);
+    EdgeBatch edges;
+    for (std::size_t i = 0; i < count; ++i) {
+        double x = distX(gen), y = distY(gen), a = angle(gen);
+        edges.add(x, y, x + length * std::cos(a), y + length * std::sin(a));
+    }
+    return edges;
+}
+
+// The fixed-step sampling that collision_avoidance_check used before CollisionChecker
+static bool legacySegmentFree(const Setup<int>& setup, double x0, double y0, double x1, double y1) {
+    double dx = x1 - x0, dy = y1 - y0;
+    int steps = static_cast<int>(std::sqrt(dx * dx + dy * dy) / setup.dim);
+    for (int i = 1; i <= steps; i++) {
+        double intermediate_x = x0 + i * dx / steps;
+        double intermediate_y = y0 + i * dy / steps;
+        if (std::abs(intermediate_x - x0) < setup.dim && std::abs(intermediate_y - y0) < setup.dim) continue;
+        if (!setup.isValid(Point<int>(intermediate_x, intermediate_y))) return false;
+    }
+    return true;
+}
+
+static constexpr std::size_t kEdgeCount = 4096;
+
+static void BM_LegacySegmentCheck(benchmark::State& state) {
+    Setup<int> setup(10, 10, 1000, 1000, Point<int>(10, 10), Point<int>(950, 950), 50);
+    addWarehouseObstacles(setup, 1000, 1000);
+    EdgeBatch edges = warehouseEdges(setup, kEdgeCount);
+    for (auto _ : state) {
+        int free = 0;
+        for (std::size_t i = 0; i < edges.size(); ++i) {
+            free += legacySegmentFree(setup, edges.x0[i], edges.y0[i], edges.x1[i], edges.y1[i]);
+        }
+        benchmark::DoNotOptimize(free);
+    }
+    state.SetItemsProcessed(state.iterations() * edges.size());
+}
+BENCHMARK(BM_LegacySegmentCheck);
+
+// range(0) is the edge length; long edges cross open floor where the clearance skip pays off
+static void BM_SegmentFree(benchmark::State& state) {
+    Setup<int> setup(10, 10, 1000, 1000, Point<int>(10, 10), Point<int>(950, 950), 50);
+    addWarehouseObstacles(setup, 1000, 1000);
+    CollisionChecker checker(setup.clearance, setup.dim, setup.footprintRadius());
+    EdgeBatch edges = warehouseEdges(setup, kEdgeCount, static_cast<double>(state.range(0)));
+    for (auto _ : state) {
+        int free = 0;
+        for (std::size_t i = 0; i < edges.size(); ++i) {
+            free += checker.segmentFree(edges.x0[i], edges.y0[i], edges.x1[i], edges.y1[i]);
+        }
+        benchmark::DoNotOptimize(free);
+    }
+    state.SetItemsProcessed(state.iterations() * edges.size());
+}
+BENCHMARK(BM_SegmentFree)->Arg(50)->Arg(400);
+
+static void BM_CheckBatch(benchmark::State& state) {
+    Setup<int> setup(10, 10, 1000, 1000, Point<int>(10, 10), Point<int>(950, 950), 50);
+    addWarehouseObstacles(setup, 1000, 1000);
+    CollisionChecker checker(setup.clearance, setup.dim, setup.footprintRadius());
+    EdgeBatch edges = warehouseEdges(setup, kEdgeCount);
+    std::vector<std::uint8_t> result;
+    for (auto _ : state) {
+        checker.checkBatch(edges, result);
+        benchmark::DoNotOptimize(result.data());
+    }
+    state.SetItemsProcessed(state.iterations() * edges.size());
+}
+BENCHMARK(BM_CheckBatch);
+
+// Query latency of the planning service on the warehouse once its roadmap is built. Each
+// iteration answers a batch of 64 queries between random free points, so the roadmap
+// construction cost is paid once outside the timed region, as it would be in a live service.
+static void BM_ServiceQuery(benchmark::State& state) {
+    int workers = static_cast<int>(state.range(0));
+    constexpr int kQueries = 64;
+    Setup<int> setup(10, 10, 1000, 1000, Point<int>(10, 10), Point<int>(950, 950), 50);
+    addWarehouseObstacles(setup, 1000, 1000);
+    CollisionChecker checker(setup.clearance, setup.dim, setup.footprintRadius());
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<> coord(0, 1000);
+    auto freePoint = [&] {
+        for (;;) {
+            Point<int> p(static_cast<int>(coord(gen)), static_cast<int>(coord(gen)));
+            if (checker.pointFree(p.getX(), p.getY())) return p;
+        }
+    };
+    std::vector<PlanQuery<int>> queries;
+    for (int i = 0; i < kQueries; ++i) {
+        queries.push_back({static_cast<std::uint64_t>(i), freePoint(), freePoint()});
+    }
+
+    std::mutex resultMutex;
+    std::vector<double> latencies;
+    int64_t found = 0;
+    PlanningService<int> service(setup, workers, [&](const PlanResult<int>& result) {
+        std::lock_guard<std::mutex> lock(resultMutex);
+        latencies.push_back(result.latencyMs);
+        found += result.found;
+    });
+
+    for (auto _ : state) {
+        for (const auto& query : queries) {
+            service.submit(query);
+        }
+        service.drain();
+    }
+    state.SetItemsProcessed(state.iterations() * kQueries);
+    state.counters["found"] = benchmark::Counter(static_cast<double>(found) / latencies.size());
+    state.counters["p50_ms"] = percentile(latencies, 0.50);
+    state.counters["p99_ms"] = percentile(latencies, 0.99);
+    state.counters["roadmap_nodes"] = static_cast<double>(service.getRoadmap().nodeCount());
+}
+BENCHMARK(BM_ServiceQuery)->Apply(threadCounts)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Lazy collision checking against plain RRT on each 2000 x 2000 scenario: the counters compare
+// the edge checks per plan (every extension in RRT, only candidate-path edges in Lazy).
+static void BM_LazyChecks(benchmark::State& state) {
+    int scenario = static_cast<int>(state.range(0));
+    PlannerMode mode = state.range(1) ? PlannerMode::Lazy : PlannerMode::RRT;
+    unsigned seed = 1;
+    std::uint64_t checks = 0, invalidated = 0;
+    std::vector<double> times;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(scenario, 2000);
+        RRTPlanner<int> rrt(*setup, seed++);
+        rrt.setMode(mode);
+        state.ResumeTiming();
+
+        auto begin = std::chrono::steady_clock::now();
+        rrt.start(1);
+        times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        checks += rrt.getMetrics()[Phase::Collision].count();
+        invalidated += rrt.getStats().invalidated;
+    }
+    state.SetLabel(std::string(scenarioName(scenario)) + (mode == PlannerMode::Lazy ? "/lazy" : "/rrt"));
+    state.counters["edge_checks"] = benchmark::Counter(static_cast<double>(checks), benchmark::Counter::kAvgIterations);
+    state.counters["invalidated"] = benchmark::Counter(static_cast<double>(invalidated), benchmark::Counter::kAvgIterations);
+    state.counters["p50_ms"] = percentile(times, 0.50);
+}
+BENCHMARK(BM_LazyChecks)->ArgsProduct({{Warehouse, RandomClutter, NarrowPassage}, {0, 1}})
+    ->Iterations(kPlansPerScenario)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Planning under a live-node bound (zero: none). Pruned runs grow into freed slots, so the
+// tree's peak memory stays flat while the plan keeps going; reports how often a path is still
+// found within the time budget, its cost, and the peak bytes of trees and indexes.
+static void BM_BoundedMemory(benchmark::State& state) {
+    int scenario = static_cast<int>(state.range(0));
+    unsigned seed = 1;
+    int found = 0, runs = 0;
+    double cost = 0;
+    std::size_t peakBytes = 0, prunes = 0;
+    std::vector<double> times;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(scenario, 2000);
+        RRTPlanner<int> rrt(*setup, seed++);
+        PlanOptions options;
+        options.timeBudget = std::chrono::milliseconds(2000);
+        options.maxTreeNodes = static_cast<std::size_t>(state.range(1));
+        options.onProgress = [&](const PlanProgress& progress) { peakBytes = std::max(peakBytes, progress.memoryBytes); };
+        state.ResumeTiming();
+
+        PlanOutcome<Point<int>> outcome = rrt.plan(options);
+        times.push_back(outcome.seconds * 1e3);
+        peakBytes = std::max(peakBytes, outcome.memoryBytes);
+        prunes += outcome.prunes;
+        ++runs;
+        if (outcome.status == PlanStatus::Found) {
+            ++found;
+            cost += outcome.cost;
+        }
+    }
+    state.SetLabel(scenarioName(scenario));
+    state.counters["found_pct"] = 100.0 * found / std::max(runs, 1);
+    state.counters["cost"] = cost / std::max(found, 1);
+    state.counters["peak_kb"] = static_cast<double>(peakBytes) / 1024;
+    state.counters["prunes"] = benchmark::Counter(static_cast<double>(prunes), benchmark::Counter::kAvgIterations);
+    state.counters["p50_ms"] = percentile(times, 0.50);
+}
+BENCHMARK(BM_BoundedMemory)->ArgsProduct({{Warehouse, NarrowPassage}, {0, 6000}})
+    ->Iterations(kPlansPerScenario)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// A 20-pick list on the 2000 x 2000 warehouse: one plan() per leg in the order given (0) against
+// one planStops() tree for all of them (1). Reports the nodes grown, and the tour cost in the
+// order given and, for the shared tree, in the order it suggests.
+static void BM_PickList(benchmark::State& state) {
+    bool shared = state.range(0) != 0;
+    unsigned seed = 1;
+    int64_t nodes = 0;
+    double listedCost = 0, orderedCost = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        auto setup = makeScenario(Warehouse, 2000);
+        Point<int> start = setup->start;
+        std::mt19937 rng(seed);
+        std::vector<Point<int>> picks;
+        while (picks.size() < 20) {
+            int x = static_cast<int>(rng() % 1980 + 10), y = static_cast<int>(rng() % 1980 + 10);
+            if (!setup->arena.isObstacle(x / setup->dim, y / setup->dim)) picks.emplace_back(x, y);
+        }
+        PlanOptions options;
+        options.timeBudget = std::chrono::milliseconds(10000);
+        state.ResumeTiming();
+
+        if (shared) {
+            RRTPlanner<int> rrt(*setup, seed);
+            PickListOutcome<Point<int>> outcome = rrt.planStops(picks, options);
+            nodes += static_cast<int64_t>(outcome.nodes);
+            listedCost += outcome.listedCost;
+            orderedCost += outcome.orderedCost;
+        } else {
+            for (const Point<int>& pick : picks) {
+                setup->target = pick;
+                RRTPlanner<int> rrt(*setup, seed);
+                PlanOutcome<Point<int>> outcome = rrt.plan(options);
+                nodes += static_cast<int64_t>(outcome.nodes);
+                listedCost += outcome.cost;
+                if (!outcome.path.empty()) setup->start = outcome.path.back();
+            }
+            setup->start = start;
+        }
+        ++seed;
+    }
+    state.SetLabel(shared ? "shared tree" : "leg by leg");
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kAvgIterations);
+    state.counters["listed_cost"] = benchmark::Counter(listedCost, benchmark::Counter::kAvgIterations);
+    if (shared) state.counters["ordered_cost"] = benchmark::Counter(orderedCost, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_PickList)->Arg(0)->Arg(1)->Iterations(10)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+// Planner scalar type on the 1000 x 1000 warehouse: int planners round every steered point to
+// whole units, float ones keep sub-unit steps at the same 4 bytes per coordinate. Reports the
+// path cost and the tree's storage per node (a 2D store keeps no z).
+template <typename T>
+static void BM_Precision(benchmark::State& state) {
+    unsigned seed = 1;
+    int64_t nodes = 0;
+    double cost = 0;
+    std::size_t bytesPerNode = 0;
+    for (auto _ : state) {
+        state.PauseTiming();
+        Setup<T> setup(10, 10, 1000, 1000, Point<T>(10, 10), Point<T>(950, 950), 50);
+        addWarehouseObstacles(setup, 1000, 1000);
+        RRTPlanner<T> rrt(setup, seed++);
+        state.ResumeTiming();
+
+        PlanOutcome<Point<T>> outcome = rrt.plan(PlanOptions());
+        nodes += static_cast<int64_t>(outcome.nodes);
+        cost += outcome.cost;
+        bytesPerNode = rrt.getTree().chunkBytes() / TreeStore<T>::ChunkSize;
+    }
+    state.counters["nodes"] = benchmark::Counter(static_cast<double>(nodes), benchmark::Counter::kAvgIterations);
+    state.counters["cost"] = benchmark::Counter(cost, benchmark::Counter::kAvgIterations);
+    state.counters["bytes_per_node"] = static_cast<double>(bytesPerNode);
+}
+BENCHMARK_TEMPLATE(BM_Precision, int)->Iterations(50)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Precision, float)->Iterations(50)->Unit(benchmark::kMillisecond);
+
+int main(int argc, char** argv) {
+    // Planner hot paths log through the global logger; discard everything while benchmarking
+    logger = spdlog::null_logger_mt("bench_logger");
+
+    benchmark::Initialize(&argc, argv);
+    if (benchmark::ReportUnrecognizedArguments(argc, argv)) return 1;
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
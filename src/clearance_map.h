@@ -0,0 +1,246 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include "occupancy_grid.h"
+
+// Clearance of every cell of an OccupancyGrid: the Euclidean gap, in cells, between the cell
+// and the nearest obstacle cell, both taken as unit squares (0 for obstacle cells and cells
+// touching one). That is the exact distance transform of the obstacles grown by one cell,
+// computed with the separable lower-envelope algorithm of Felzenszwalb and Huttenlocher.
+// Values are capped at MaxClearance, so an obstacle change only affects cells within that
+// distance: changes are collected with markChanged() and update() recomputes just the
+// windows around them.
+// Values are computed lazily in chunks of 256x256 cells, the first time a chunk is read, so a
+// huge arena costs nothing until the planner reaches a region and only the reached chunks are
+// ever held. All access goes through one mutex; readers copy what they need (see read()).
+class ClearanceMap {
+public:
+    static constexpr int MaxClearance = 32;
+    static constexpr int ChunkBits = 8;
+    static constexpr int ChunkSize = 1 << ChunkBits;
+
+private:
+    struct Window {
+        int x0, y0, x1, y1;
+    };
+
+    const OccupancyGrid& obstacles;
+    int chunksX = 0, chunksY = 0;
+    std::vector<std::unique_ptr<float[]>> chunks;  // null until computed
+    std::size_t computedChunks = 0;
+    std::vector<Window> changed;
+    mutable std::mutex mutex;
+    // Scratch for the 1D transforms
+    std::vector<double> f, d, z;
+    std::vector<int> v;
+    std::vector<double> dist2;
+
+    std::size_t chunkOf(int x, int y) const { return static_cast<std::size_t>(y >> ChunkBits) * chunksX + (x >> ChunkBits); }
+    static std::size_t inChunk(int x, int y) { return (static_cast<std::size_t>(y & (ChunkSize - 1)) << ChunkBits) + (x & (ChunkSize - 1)); }
+
+    // Values of the chunk holding (x, y), computed on first use; caller holds the mutex
+    const float* chunkAt(int x, int y) {
+        std::unique_ptr<float[]>& chunk = chunks[chunkOf(x, y)];
+        if (!chunk) {
+            chunk.reset(new float[ChunkSize * ChunkSize]);
+            ++computedChunks;
+            int x0 = x & ~(ChunkSize - 1), y0 = y & ~(ChunkSize - 1);
+            recompute({x0, y0, std::min(obstacles.cols(), x0 + ChunkSize) - 1, std::min(obstacles.rows(), y0 + ChunkSize) - 1});
+        }
+        return chunk.get();
+    }
+
+    // Squared distance transform of the sampled function f[0..n) into d[0..n)
+    void transform1D(int n) {
+        const double inf = std::numeric_limits<double>::infinity();
+        auto intersect = [this](int q, int p) { return ((f[q] + q * q) - (f[p] + p * p)) / (2.0 * (q - p)); };
+        // Lower envelope of the parabolas rooted at the finite samples
+        int k = -1;
+        for (int q = 0; q < n; ++q) {
+            if (f[q] == inf) continue;
+            if (k < 0) {
+                k = 0;
+                v[0] = q;
+                z[0] = -inf;
+                z[1] = inf;
+                continue;
+            }
+            double s = intersect(q, v[k]);
+            while (s <= z[k]) {
+                --k;
+                s = intersect(q, v[k]);
+            }
+            ++k;
+            v[k] = q;
+            z[k] = s;
+            z[k + 1] = inf;
+        }
+        if (k < 0) {
+            std::fill_n(d.begin(), n, inf);
+            return;
+        }
+        k = 0;
+        for (int q = 0; q < n; ++q) {
+            while (z[k + 1] < q) ++k;
+            d[q] = static_cast<double>(q - v[k]) * (q - v[k]) + f[v[k]];
+        }
+    }
+
+    // Obstacle grown by one cell: the cell is an obstacle or touches one
+    bool source(int x, int y) const {
+        for (int iy = std::max(0, y - 1); iy <= std::min(obstacles.rows() - 1, y + 1); ++iy) {
+            for (int ix = std::max(0, x - 1); ix <= std::min(obstacles.cols() - 1, x + 1); ++ix) {
+                if (obstacles.isObstacle(ix, iy)) return true;
+            }
+        }
+        return false;
+    }
+
+    // Recompute the cells of 'w' that lie in computed chunks. Only sources within
+    // MaxClearance + 1 of the window can matter.
+    void recompute(const Window& w) {
+        int margin = MaxClearance + 1;
+        int sx0 = std::max(0, w.x0 - margin), sy0 = std::max(0, w.y0 - margin);
+        int sx1 = std::min(obstacles.cols() - 1, w.x1 + margin), sy1 = std::min(obstacles.rows() - 1, w.y1 + margin);
+        int width = sx1 - sx0 + 1, height = sy1 - sy0 + 1;
+        int n = std::max(width, height);
+        f.resize(n);
+        d.resize(n);
+        z.resize(n + 1);
+        v.resize(n);
+        dist2.assign(static_cast<std::size_t>(width) * height, 0);
+
+        const double inf = std::numeric_limits<double>::infinity();
+        for (int x = 0; x < width; ++x) {
+            for (int y = 0; y < height; ++y) {
+                f[y] = source(sx0 + x, sy0 + y) ? 0 : inf;
+            }
+            transform1D(height);
+            for (int y = 0; y < height; ++y) {
+                dist2[static_cast<std::size_t>(y) * width + x] = d[y];
+            }
+        }
+        for (int y = w.y0 - sy0; y <= w.y1 - sy0; ++y) {
+            std::copy_n(dist2.begin() + static_cast<std::size_t>(y) * width, width, f.begin());
+            transform1D(width);
+            for (int x = w.x0 - sx0; x <= w.x1 - sx0; ++x) {
+                float* chunk = chunks[chunkOf(sx0 + x, sy0 + y)].get();
+                if (chunk) chunk[inChunk(sx0 + x, sy0 + y)] = static_cast<float>(std::min(std::sqrt(d[x]), static_cast<double>(MaxClearance)));
+            }
+        }
+    }
+
+public:
+    // Whether any computed chunk overlaps the window
+    bool touchesComputed(const Window& w) const {
+        for (int cy = w.y0 >> ChunkBits; cy <= w.y1 >> ChunkBits; ++cy) {
+            for (int cx = w.x0 >> ChunkBits; cx <= w.x1 >> ChunkBits; ++cx) {
+                if (chunks[static_cast<std::size_t>(cy) * chunksX + cx]) return true;
+            }
+        }
+        return false;
+    }
+
+public:
+    explicit ClearanceMap(const OccupancyGrid& obstacles)
+        : obstacles(obstacles),
+          chunksX((obstacles.cols() + ChunkSize - 1) >> ChunkBits), chunksY((obstacles.rows() + ChunkSize - 1) >> ChunkBits),
+          chunks(static_cast<std::size_t>(chunksX) * chunksY) {}
+
+    const OccupancyGrid& grid() const { return obstacles; }
+
+    // Drop every computed value; chunks are recomputed from the current obstacles when next read
+    void rebuild() {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& chunk : chunks) chunk.reset();
+        computedChunks = 0;
+        changed.clear();
+    }
+
+    // Note that the obstacle bit of a cell was set or cleared; takes effect on update()
+    void markChanged(int x, int y) { markChanged(x, y, x, y); }
+
+    // Same for every cell of the rectangle [x0,x1] x [y0,y1]
+    void markChanged(int x0, int y0, int x1, int y1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Nearby changes share one window, so an obstacle rectangle becomes a single update
+        if (!changed.empty()) {
+            Window& last = changed.back();
+            if (x0 <= last.x1 + MaxClearance && x1 >= last.x0 - MaxClearance &&
+                y0 <= last.y1 + MaxClearance && y1 >= last.y0 - MaxClearance) {
+                last = {std::min(last.x0, x0), std::min(last.y0, y0), std::max(last.x1, x1), std::max(last.y1, y1)};
+                return;
+            }
+        }
+        changed.push_back({x0, y0, x1, y1});
+    }
+
+    bool pending() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !changed.empty();
+    }
+
+    // Bring the computed cells around every change since the last update up to date
+    void update() {
+        update([](int, int, int, int) {});
+    }
+
+    // Same, and call affected(x0, y0, x1, y1) with every window of cells whose clearance may
+    // have changed, so caches derived from the clearance can drop just those cells
+    template <typename Affected>
+    void update(Affected&& affected) {
+        std::unique_lock<std::mutex> lock(mutex);
+        int reach = MaxClearance + 1;
+        std::vector<Window> windows;
+        std::size_t area = 0;
+        for (const Window& c : changed) {
+            windows.push_back({std::max(0, c.x0 - reach), std::max(0, c.y0 - reach),
+                               std::min(obstacles.cols() - 1, c.x1 + reach), std::min(obstacles.rows() - 1, c.y1 + reach)});
+            area += static_cast<std::size_t>(c.x1 - c.x0 + 3 * MaxClearance) * (c.y1 - c.y0 + 3 * MaxClearance);
+        }
+        changed.clear();
+        // Many scattered changes cost more window by window than recomputing what was computed
+        if (area > computedChunks * ChunkSize * ChunkSize) {
+            for (auto& chunk : chunks) chunk.reset();
+            computedChunks = 0;
+        } else {
+            for (const Window& w : windows) {
+                if (touchesComputed(w)) recompute(w);
+            }
+        }
+        lock.unlock();
+        for (const Window& w : windows) affected(w.x0, w.y0, w.x1, w.y1);
+    }
+
+    // Call visit(x, y, gap) for every cell of [x0,x1] x [y0,y1] (inside the grid), row by row
+    template <typename Visit>
+    void read(int x0, int y0, int x1, int y1, Visit&& visit) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1;) {
+                const float* chunk = chunkAt(x, y);
+                int last = std::min(x1, x | (ChunkSize - 1));
+                for (; x <= last; ++x) visit(x, y, chunk[inChunk(x, y)]);
+            }
+        }
+    }
+
+    // Gap in cells between (x, y) and the nearest obstacle cell, at most MaxClearance
+    float clearance(int x, int y) {
+        std::lock_guard<std::mutex> lock(mutex);
+        return chunkAt(x, y)[inChunk(x, y)];
+    }
+
+    // Chunks computed so far and the bytes they hold
+    std::size_t chunkCount() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return computedChunks;
+    }
+    std::size_t memoryBytes() const { return chunkCount() * ChunkSize * ChunkSize * sizeof(float) + chunks.size() * sizeof(chunks[0]); }
+};
@@ -0,0 +1,316 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include "zeroed_pages.h"
+#include "occupancy_grid.h"
+#include "clearance_map.h"
+
+// Structure-of-arrays batch of candidate edges (world coordinates)
+struct EdgeBatch {
+    std::vector<double> x0, y0, x1, y1;
+
+    void add(double ax, double ay, double bx, double by) {
+        x0.push_back(ax);
+        y0.push_back(ay);
+        x1.push_back(bx);
+        y1.push_back(by);
+    }
+    std::size_t size() const { return x0.size(); }
+    void clear() {
+        x0.clear();
+        y0.clear();
+        x1.clear();
+        y1.clear();
+    }
+};
+
+// Segment collision checks against an OccupancyGrid, using its ClearanceMap.
+// A cell is blocked when its clearance is below the robot's footprint radius (the disc around
+// the robot), so a segment is free exactly when every grid cell its centre line passes through
+// is free. Cells are enumerated with an exact Amanatides-Woo traversal that stops at the first
+// blocked cell. Cells are kept as one byte each in a row-major array with a one-cell border, so
+// each step of the traversal is a single load. The byte of a free cell also says how far (in
+// whole cells) any segment through it can move without reaching a blocked cell; on open floor
+// the traversal jumps by that much instead of stepping cell by cell.
+// A per-block summary (8x8 cells) lets segments whose bounding box only touches empty blocks
+// skip the traversal entirely; checkBatch computes those bounding boxes for many edges at once.
+// Cells are filled in lazily, one 64x64 tile at a time, when a check first reaches the tile:
+// the arrays live in zeroed pages where zero means "not computed yet", so checks on a huge
+// arena only pay for the tiles they visit. Tiles are filled under a mutex; every byte is
+// complete on its own, so concurrent checks read them with relaxed atomic loads (plain loads).
+class CollisionChecker {
+public:
+    static constexpr int BlockBits = 3;
+    static constexpr int BlockSize = 1 << BlockBits;
+    static constexpr int TileBits = OccupancyGrid::TileBits;
+    // Shortest skip worth restarting the traversal for; a restart costs several single steps
+    static constexpr int MinSkip = 8;
+
+private:
+    // Cell bytes: Unknown, Blocked, or FreeBase + skip distance
+    static constexpr std::uint8_t Unknown = 0, Blocked = 1, FreeBase = 2;
+    static constexpr int MaxSkip = 255 - FreeBase;
+
+    ClearanceMap& clearance;
+    const OccupancyGrid& grid;
+    double cellSize, invCellSize;
+    double radius;
+    int stride = 0;
+    int blocksX = 0, blocksY = 0, tilesX = 0, tilesY = 0;
+    mutable ZeroedPages<std::atomic<std::uint8_t>> cells;
+    // Obstacle cells per block plus one; 0 while the block's tile is not computed
+    mutable ZeroedPages<std::atomic<std::uint32_t>> blockObstacles;
+    mutable ZeroedPages<std::atomic<std::uint8_t>> tileReady;
+    mutable std::mutex fillMutex;
+    mutable std::atomic<std::size_t> filled{0};
+
+    // floor() without the libm call; world coordinates are far inside int range
+    static int cellOf(double v) {
+        int i = static_cast<int>(v);
+        return i - (v < i);
+    }
+
+    std::size_t cellIndex(int x, int y) const { return static_cast<std::size_t>(y + 1) * stride + (x + 1); }
+
+    // Compute the states of the tile holding cell (x, y) unless another check already has
+    [[gnu::noinline]] void fillTile(int x, int y) const {
+        std::size_t tile = static_cast<std::size_t>(y >> TileBits) * tilesX + (x >> TileBits);
+        if (tileReady[tile].load(std::memory_order_acquire)) return;
+        std::lock_guard<std::mutex> lock(fillMutex);
+        if (tileReady[tile].load(std::memory_order_relaxed)) return;
+
+        int x0 = x & ~(OccupancyGrid::TileSize - 1), y0 = y & ~(OccupancyGrid::TileSize - 1);
+        int x1 = std::min(grid.cols(), x0 + OccupancyGrid::TileSize) - 1, y1 = std::min(grid.rows(), y0 + OccupancyGrid::TileSize) - 1;
+        std::uint32_t counts[OccupancyGrid::TileSize / BlockSize][OccupancyGrid::TileSize / BlockSize] = {};
+        // A point within s of a cell lies in a cell whose centre is within s + sqrt(2) of this
+        // one's, and clearance drops by at most that centre distance
+        double slack = radius + std::sqrt(2.0);
+        clearance.read(x0, y0, x1, y1, [&](int cx, int cy, float gap) {
+            std::uint8_t value = Blocked;
+            if (gap < radius) {
+                ++counts[(cy - y0) >> BlockBits][(cx - x0) >> BlockBits];
+            } else {
+                value = static_cast<std::uint8_t>(FreeBase + std::clamp(std::floor(gap - slack), 0.0, static_cast<double>(MaxSkip)));
+            }
+            cells[cellIndex(cx, cy)].store(value, std::memory_order_relaxed);
+        });
+        for (int by = y0 >> BlockBits; by <= y1 >> BlockBits; ++by) {
+            for (int bx = x0 >> BlockBits; bx <= x1 >> BlockBits; ++bx) {
+                blockObstacles[static_cast<std::size_t>(by) * blocksX + bx].store(counts[by - (y0 >> BlockBits)][bx - (x0 >> BlockBits)] + 1, std::memory_order_relaxed);
+            }
+        }
+        filled.fetch_add(1, std::memory_order_relaxed);
+        tileReady[tile].store(1, std::memory_order_release);
+    }
+
+    // Return a computed tile to the unknown state; false if it was not computed
+    bool dropTile(int tx, int ty) {
+        std::size_t tile = static_cast<std::size_t>(ty) * tilesX + tx;
+        if (!tileReady[tile].load(std::memory_order_relaxed)) return false;
+        int x0 = tx << TileBits, y0 = ty << TileBits;
+        int x1 = std::min(grid.cols(), x0 + OccupancyGrid::TileSize) - 1, y1 = std::min(grid.rows(), y0 + OccupancyGrid::TileSize) - 1;
+        for (int y = y0; y <= y1; ++y) {
+            for (int x = x0; x <= x1; ++x) {
+                cells[cellIndex(x, y)].store(Unknown, std::memory_order_relaxed);
+            }
+        }
+        for (int by = y0 >> BlockBits; by <= y1 >> BlockBits; ++by) {
+            for (int bx = x0 >> BlockBits; bx <= x1 >> BlockBits; ++bx) {
+                blockObstacles[static_cast<std::size_t>(by) * blocksX + bx].store(0, std::memory_order_relaxed);
+            }
+        }
+        tileReady[tile].store(0, std::memory_order_relaxed);
+        filled.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    std::uint8_t load(std::ptrdiff_t cell) const { return cells[cell].load(std::memory_order_relaxed); }
+
+    // Byte of a cell met during a traversal whose tile may not be computed yet; border cells
+    // are blocked
+    [[gnu::noinline]] std::uint8_t resolve(std::ptrdiff_t cell) const {
+        int x = static_cast<int>(cell % stride) - 1, y = static_cast<int>(cell / stride) - 1;
+        if (!grid.inBounds(x, y)) return Blocked;
+        fillTile(x, y);
+        return load(cell);
+    }
+
+    // Byte of an in-grid cell, computing its tile if needed
+    std::uint8_t cellValue(int x, int y) const {
+        std::uint8_t v = load(static_cast<std::ptrdiff_t>(cellIndex(x, y)));
+        return v != Unknown ? v : resolve(static_cast<std::ptrdiff_t>(cellIndex(x, y)));
+    }
+
+    bool blocked(int x, int y) const { return !grid.inBounds(x, y) || cellValue(x, y) < FreeBase; }
+
+    // True if every block overlapped by the cell rectangle [cx0,cx1]x[cy0,cy1] is inside the grid and empty
+    bool boxEmpty(int cx0, int cy0, int cx1, int cy1) const {
+        if (cx0 < 0 || cy0 < 0 || cx1 >= grid.cols() || cy1 >= grid.rows()) return false;
+        for (int by = cy0 >> BlockBits; by <= cy1 >> BlockBits; ++by) {
+            for (int bx = cx0 >> BlockBits; bx <= cx1 >> BlockBits; ++bx) {
+                auto& block = blockObstacles[static_cast<std::size_t>(by) * blocksX + bx];
+                std::uint32_t count = block.load(std::memory_order_relaxed);
+                if (count == 0) {
+                    fillTile(bx << BlockBits, by << BlockBits);
+                    count = block.load(std::memory_order_relaxed);
+                }
+                if (count != 1) return false;
+            }
+        }
+        return true;
+    }
+
+public:
+    // footprintRadius: radius of the disc covering the robot, in world units
+    CollisionChecker(ClearanceMap& clearance, double cellSize, double footprintRadius)
+        : clearance(clearance), grid(clearance.grid()), cellSize(cellSize), invCellSize(1.0 / cellSize),
+          radius(std::max(0.0, footprintRadius) / cellSize) {
+        rebuild();
+    }
+
+    // Forget every computed tile after the obstacle layer changed (and was reported to the
+    // ClearanceMap); tiles are recomputed when next reached. Not safe during concurrent checks.
+    void rebuild() {
+        clearance.update();
+        stride = grid.cols() + 2;
+        blocksX = (grid.cols() + BlockSize - 1) >> BlockBits;
+        blocksY = (grid.rows() + BlockSize - 1) >> BlockBits;
+        tilesX = (grid.cols() + OccupancyGrid::TileSize - 1) >> TileBits;
+        tilesY = (grid.rows() + OccupancyGrid::TileSize - 1) >> TileBits;
+        cells = ZeroedPages<std::atomic<std::uint8_t>>(static_cast<std::size_t>(stride) * (grid.rows() + 2));
+        blockObstacles = ZeroedPages<std::atomic<std::uint32_t>>(static_cast<std::size_t>(blocksX) * blocksY);
+        tileReady = ZeroedPages<std::atomic<std::uint8_t>>(static_cast<std::size_t>(tilesX) * tilesY);
+        filled.store(0, std::memory_order_relaxed);
+    }
+
+    // Apply the obstacle changes reported to the ClearanceMap since the last update, dropping
+    // only the computed tiles whose clearance they can reach; returns how many were dropped.
+    // The cost follows the size of the change, not of the arena. Not safe during concurrent checks.
+    std::size_t refresh() {
+        std::size_t dropped = 0;
+        clearance.update([&](int x0, int y0, int x1, int y1) {
+            for (int ty = y0 >> TileBits; ty <= y1 >> TileBits; ++ty) {
+                for (int tx = x0 >> TileBits; tx <= x1 >> TileBits; ++tx) {
+                    if (dropTile(tx, ty)) ++dropped;
+                }
+            }
+        });
+        return dropped;
+    }
+
+    // Tiles computed so far
+    std::size_t filledTiles() const { return filled.load(std::memory_order_relaxed); }
+
+    // Radius of the robot's footprint disc, in cells
+    double footprintRadiusCells() const { return radius; }
+
+    // Is the cell under a world point free for the robot?
+    bool pointFree(double x, double y) const {
+        return !blocked(cellOf(x * invCellSize), cellOf(y * invCellSize));
+    }
+
+    // Clearance-derived skip distance of a free cell, in whole cells
+    int skipCells(int x, int y) const {
+        std::uint8_t v = grid.inBounds(x, y) ? cellValue(x, y) : Blocked;
+        return v < FreeBase ? 0 : v - FreeBase;
+    }
+
+    // Exact traversal of the cells crossed by the segment (x0,y0)->(x1,y1).
+    // The cell containing the start point is not tested (it already holds a tree node),
+    // but a segment starting outside the arena is never free.
+    bool segmentFree(double x0, double y0, double x1, double y1) const {
+        double fx0 = x0 * invCellSize, fy0 = y0 * invCellSize;
+        double fx1 = x1 * invCellSize, fy1 = y1 * invCellSize;
+        int cx = cellOf(fx0), cy = cellOf(fy0);
+        int ex = cellOf(fx1), ey = cellOf(fy1);
+
+        if (!grid.inBounds(cx, cy)) return false;
+        if (boxEmpty(std::min(cx, ex), std::min(cy, ey), std::max(cx, ex), std::max(cy, ey))) return true;
+        // The arena is convex, so only a segment ending outside it can leave it; skipping ahead
+        // could otherwise jump over the border
+        if (!grid.inBounds(ex, ey)) return false;
+
+        double dx = fx1 - fx0, dy = fy1 - fy0;
+        double invLength = 1.0 / std::sqrt(dx * dx + dy * dy);
+        int stepX = dx > 0 ? 1 : -1, stepY = dy > 0 ? 1 : -1;
+        const double inf = std::numeric_limits<double>::infinity();
+        double tDeltaX = dx != 0 ? 1.0 / std::abs(dx) : inf;
+        double tDeltaY = dy != 0 ? 1.0 / std::abs(dy) : inf;
+        double tMaxX = dx != 0 ? (stepX > 0 ? cx + 1 - fx0 : fx0 - cx) * tDeltaX : inf;
+        double tMaxY = dy != 0 ? (stepY > 0 ? cy + 1 - fy0 : fy0 - cy) * tDeltaY : inf;
+
+        // Exactly one cell boundary is crossed per step; never step past the end cell on either axis.
+        // The border is blocked, so the walk stops before 'cell' can leave the padded grid.
+        int leftX = std::abs(ex - cx), leftY = std::abs(ey - cy);
+        std::ptrdiff_t cell = static_cast<std::ptrdiff_t>(cellIndex(cx, cy));
+        std::ptrdiff_t rowStep = stepY * static_cast<std::ptrdiff_t>(stride);
+        double t = 0;
+        // The start cell is not tested: if its tile is not computed yet it just does not skip
+        std::uint8_t value = load(cell);
+        while (leftX + leftY > 0) {
+            // Every cell within the skip distance of the current point is free: restart the walk past them
+            if (value >= FreeBase + MinSkip) {
+                t += (value - FreeBase) * invLength;
+                if (t >= 1) return true;
+                double px = fx0 + t * dx, py = fy0 + t * dy;
+                cx = cellOf(px), cy = cellOf(py);
+                tMaxX = dx != 0 ? t + (stepX > 0 ? cx + 1 - px : px - cx) * tDeltaX : inf;
+                tMaxY = dy != 0 ? t + (stepY > 0 ? cy + 1 - py : py - cy) * tDeltaY : inf;
+                leftX = std::abs(ex - cx), leftY = std::abs(ey - cy);
+                cell = static_cast<std::ptrdiff_t>(cellIndex(cx, cy));
+            } else if ((tMaxX < tMaxY && leftX > 0) || leftY == 0) {
+                cell += stepX;
+                t = tMaxX;
+                tMaxX += tDeltaX;
+                --leftX;
+            } else {
+                cell += rowStep;
+                t = tMaxY;
+                tMaxY += tDeltaY;
+                --leftY;
+            }
+            value = load(cell);
+            if (value < FreeBase && (value == Blocked || (value = resolve(cell)) < FreeBase)) return false;
+        }
+        return true;
+    }
+
+    // Checks every edge of the batch; result[i] is 1 if edge i is free.
+    // Cell bounding boxes are computed in one branch-free pass over the batch (vectorized by
+    // the compiler); only edges that touch a block containing obstacles fall back to traversal.
+    void checkBatch(const EdgeBatch& edges, std::vector<std::uint8_t>& result) const {
+        result.assign(edges.size(), 0);
+        checkBatch(edges, 0, edges.size(), result.data());
+    }
+
+    // Edges [begin, end) of the batch into result[begin, end); threads may check disjoint ranges
+    void checkBatch(const EdgeBatch& edges, std::size_t begin, std::size_t end, std::uint8_t* result) const {
+        std::size_t n = end - begin;
+        std::vector<int> bx0(n), by0(n), bx1(n), by1(n);
+        const double* x0 = edges.x0.data() + begin;
+        const double* y0 = edges.y0.data() + begin;
+        const double* x1 = edges.x1.data() + begin;
+        const double* y1 = edges.y1.data() + begin;
+        result += begin;
+        for (std::size_t i = 0; i < n; ++i) {
+            bx0[i] = static_cast<int>(std::min(x0[i], x1[i]) * invCellSize);
+            by0[i] = static_cast<int>(std::min(y0[i], y1[i]) * invCellSize);
+            bx1[i] = static_cast<int>(std::max(x0[i], x1[i]) * invCellSize);
+            by1[i] = static_cast<int>(std::max(y0[i], y1[i]) * invCellSize);
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            bool negative = std::min(x0[i], x1[i]) < 0 || std::min(y0[i], y1[i]) < 0;
+            if (!negative && boxEmpty(bx0[i], by0[i], bx1[i], by1[i])) {
+                result[i] = 1;
+            } else {
+                result[i] = segmentFree(x0[i], y0[i], x1[i], y1[i]);
+            }
+        }
+    }
+};
@@ -1,41 +1,249 @@
 #include "arena_definitions.cpp"
+#include <prometheus/exposer.h>
+#include "metrics_exporter.h"
+#include "planning_service.h"
+#include "path_smoother.h"
+#include "planner_portfolio.h"
+#include "snapshot_renderer.h"
+#include <iostream>
+#include <cstring>
 
-int main() {
+// Reads the numbers following "key": in one request line, e.g. "start":[10,10]
+static bool readNumbers(const std::string& line, const char* key, double* out, int n) {
+    std::size_t pos = line.find(std::string("\"") + key + "\"");
+    if (pos == std::string::npos) return false;
+    const char* p = line.c_str() + pos + std::strlen(key) + 2;
+    for (int i = 0; i < n; ++i) {
+        while (*p && !(std::isdigit(static_cast<unsigned char>(*p)) || *p == '-' || *p == '.')) ++p;
+        if (!*p) return false;
+        char* end;
+        out[i] = std::strtod(p, &end);
+        p = end;
+    }
+    return true;
+}
+
+// Planning service mode: one JSON request per stdin line,
+//   {"id": 1, "start": [10, 10], "goal": [950, 950]}
+// answered with one JSON line per request on stdout (in completion order):
+//   {"id": 1, "found": true, "cost": 1431.2, "latency_ms": 0.41, "path": [[10,10], ...]}
+static int serve(Setup<int>& setup) {
+    std::mutex outputMutex;
+    PlanningService<int> service(setup, std::max(1u, std::thread::hardware_concurrency()), [&](const PlanResult<int>& result) {
+        std::string line = fmt::format("{{\"id\": {}, \"found\": {}, \"cost\": {:.3f}, \"latency_ms\": {:.3f}, \"path\": [",
+                                       result.id, result.found ? "true" : "false", result.cost, result.latencyMs);
+        for (std::size_t i = 0; i < result.path.size(); ++i) {
+            line += fmt::format("{}[{},{}]", i ? "," : "", result.path[i].getX(), result.path[i].getY());
+        }
+        line += "]}\n";
+        std::lock_guard<std::mutex> lock(outputMutex);
+        std::cout << line << std::flush;
+    });
+
+    std::string line;
+    while (std::getline(std::cin, line)) {
+        double id, start[2], goal[2];
+        if (!readNumbers(line, "id", &id, 1) || !readNumbers(line, "start", start, 2) || !readNumbers(line, "goal", goal, 2)) {
+            logger->warn("Ignoring malformed request: {}", line);
+            continue;
+        }
+        service.submit({static_cast<std::uint64_t>(id), Point<int>(static_cast<int>(start[0]), static_cast<int>(start[1])),
+                        Point<int>(static_cast<int>(goal[0]), static_cast<int>(goal[1]))});
+    }
+    service.drain();
+    return 0;
+}
+
+// Command line:
+//   rrt_3d [--map arena.rrtmap [--route sx sy gx gy]] [--serve] [--lazy] [--budget ms] [--max-tree-mb N] [--portfolio N [--keep-best ms]]
+//          [--spline]             (fits a spline through the smoothed path; many more waypoints)
+//   rrt_3d --import occupancy.png|.pgm arena.rrtmap <cell size>
+//   rrt_3d --export arena.rrtmap          (writes the built-in warehouse)
+//   rrt_3d ... --snapshot run.rrtsnap     (also dumps the tree, path and arena after planning)
+//   rrt_3d --render run.rrtsnap tree.png
+//   rrt_3d --render-frames run.rrtsnap frames/tree <count>
+int main(int argc, char** argv) {
     // Set up logger - this initializes the global logger variable
     setupLogger();
 
     // Parameters for the simulation
     int width = 1000, height = 1000, step_size = 50;
+    Point<int> start(10, 10), target(950, 950);
+    std::string mapPath;
+    bool serveMode = false;
+    int portfolioSize = 0;
+    int keepBestMs = 0;
+    int budgetMs = 0;
+    bool lazy = false;
+    bool spline = false;
+    double maxTreeMb = 0;
+    std::string snapshotPath;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--serve") {
+            serveMode = true;
+        } else if (arg == "--lazy") {
+            lazy = true;
+        } else if (arg == "--spline") {
+            spline = true;
+        } else if (arg == "--budget" && i + 1 < argc) {
+            budgetMs = std::atoi(argv[++i]);
+        } else if (arg == "--max-tree-mb" && i + 1 < argc) {
+            maxTreeMb = std::atof(argv[++i]);
+        } else if (arg == "--portfolio" && i + 1 < argc) {
+            portfolioSize = std::atoi(argv[++i]);
+        } else if (arg == "--keep-best" && i + 1 < argc) {
+            keepBestMs = std::atoi(argv[++i]);
+        } else if (arg == "--map" && i + 1 < argc) {
+            mapPath = argv[++i];
+        } else if (arg == "--route" && i + 4 < argc) {
+            start = Point<int>(std::atoi(argv[i + 1]), std::atoi(argv[i + 2]));
+            target = Point<int>(std::atoi(argv[i + 3]), std::atoi(argv[i + 4]));
+            i += 4;
+        } else if (arg == "--import" && i + 3 < argc) {
+            bool imported = importOccupancyImage(argv[i + 1], argv[i + 2], std::atof(argv[i + 3]));
+            spdlog::shutdown();
+            return imported ? 0 : 1;
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshotPath = argv[++i];
+        } else if ((arg == "--render" && i + 2 < argc) || (arg == "--render-frames" && i + 3 < argc)) {
+            std::string error;
+            std::unique_ptr<TreeSnapshot> snapshot = TreeSnapshot::load(argv[i + 1], error);
+            bool rendered = false;
+            if (!snapshot) {
+                logger->error("Could not load snapshot: {}", error);
+            } else if (arg == "--render") {
+                rendered = SnapshotRenderer(*snapshot).writeImage(argv[i + 2]);
+            } else {
+                int frames = std::atoi(argv[i + 3]);
+                rendered = SnapshotRenderer(*snapshot).writeFrames(argv[i + 2], frames) == std::max(1, frames);
+            }
+            spdlog::shutdown();
+            return rendered ? 0 : 1;
+        } else if (arg == "--export" && i + 1 < argc) {
+            Setup<int> setup(10, 10, width, height, start, target, step_size);
+            addWarehouseObstacles(setup, width, height);
+            bool saved = setup.saveMap(argv[i + 1]);
+            spdlog::shutdown();
+            return saved ? 0 : 1;
+        } else {
+            std::cerr << "Unknown or incomplete option: " << arg << std::endl;
+            return 2;
+        }
+    }
     auto start_time = std::chrono::high_resolution_clock::now();
 
-    // RRT Setup
-    Setup<int> setup(10, 10, width, height, Point<int>(10, 10), Point<int>(950, 950), step_size);
-    addWarehouseObstacles(setup, width, height); // Assume this function is defined elsewhere
-
-    // Prometheus metric setup
-    //prometheus::Exposer exposer{"127.0.0.1:8080"};
-    //auto registry = std::make_shared<prometheus::Registry>();
-    //auto& gauge_family = prometheus::BuildGauge()
-     //                       .Name("rrt_execution_time")
-     //                       .Help("RRT execution time in milliseconds")
-     //                       .Register(*registry);
-    //auto& gauge = gauge_family.Add({{"metric", "execution_time"}});
-
-    // Start the RRT Planner
-    RRTPlanner<int> rrt(setup);
-    rrt.start(1);
+    // RRT Setup: a mapped arena, or the built-in warehouse
+    std::unique_ptr<Setup<int>> arenaSetup;
+    if (!mapPath.empty()) {
+        std::string error;
+        std::unique_ptr<TiledMapFile> map = TiledMapFile::open(mapPath, error);
+        if (!map) {
+            logger->error("Could not load map: {}", error);
+            spdlog::shutdown();
+            return 1;
+        }
+        arenaSetup = std::make_unique<Setup<int>>(10, 10, std::move(map), start, target, step_size);
+    } else {
+        arenaSetup = std::make_unique<Setup<int>>(10, 10, width, height, start, target, step_size);
+        addWarehouseObstacles(*arenaSetup, width, height); // Assume this function is defined elsewhere
+    }
+    Setup<int>& setup = *arenaSetup;
+
+    if (serveMode) {
+        int status = serve(setup);
+        spdlog::shutdown();
+        return status;
+    }
+
+    // Prometheus metric setup; the pull endpoint is the port rrt_project_service.yaml targets
+    prometheus::Exposer exposer{"0.0.0.0:8080"};
+    auto registry = std::make_shared<prometheus::Registry>();
+    exposer.RegisterCollectable(registry);
+    auto& gauge_family = prometheus::BuildGauge()
+                            .Name("rrt_execution_time")
+                            .Help("RRT execution time in milliseconds")
+                            .Register(*registry);
+    auto& gauge = gauge_family.Add({{"metric", "execution_time"}});
+    PlannerMetricsExporter metrics(registry);
+
+    // Start the RRT Planner, or race a portfolio of differently configured planners
+    std::unique_ptr<RRTPlanner<int>> planner;
+    if (portfolioSize > 0) {
+        PortfolioOptions portfolio;
+        portfolio.planners = portfolioSize;
+        portfolio.seed = std::random_device{}();
+        portfolio.keepBest = keepBestMs > 0;
+        portfolio.deadline = std::chrono::milliseconds(keepBestMs);
+        planner = PlannerPortfolio<int>(setup, portfolio).run().planner;
+        if (!planner) {
+            spdlog::shutdown();
+            return 1;
+        }
+    } else {
+        // --budget caps the planning time; without it an unreachable target is reported up front.
+        // --max-tree-mb keeps the trees within a memory bound by pruning them as they grow.
+        planner = std::make_unique<RRTPlanner<int>>(setup);
+        if (lazy) planner->setMode(PlannerMode::Lazy);
+        PlanOptions options;
+        options.threads = std::max(1u, std::thread::hardware_concurrency());
+        options.timeBudget = std::chrono::milliseconds(budgetMs);
+        options.maxTreeBytes = static_cast<std::size_t>(maxTreeMb * (1 << 20));
+        PlanOutcome<Point<int>> outcome = planner->plan(options);
+        if (outcome.status != PlanStatus::Found) {
+            logger->error("No path ({}) after {:.3f} ms; the tree got within {:.1f} of the target", planStatusName(outcome.status),
+                          outcome.seconds * 1e3, outcome.remainingDistance);
+            spdlog::shutdown();
+            return 1;
+        }
+    }
+    RRTPlanner<int>& rrt = *planner;
     std::vector<Point<int>> path = rrt.getShortestPath();
 
+    // Replace the tree's zig-zag with shortcuts, and with a spline the controllers can follow if asked
+    SmoothingOptions smoothing;
+    smoothing.threads = std::max(1u, std::thread::hardware_concurrency());
+    smoothing.spline = spline;
+    SmoothingReport smoothed;
+    path = PathSmoother<Point<int>>(rrt.getCollisionChecker(), setup.dim, smoothing, rrt.getVolume()).smooth(path, smoothed);
+    logger->info("Path smoothed in {:.3f} ms: {} -> {} waypoints, length {:.1f} -> {:.1f}", smoothed.seconds * 1e3,
+                 smoothed.waypointsBefore, smoothed.waypointsAfter, smoothed.lengthBefore, smoothed.lengthAfter);
+
     // Stop timing after target is reached
     auto end_time = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
     logger->info("RRT completed in {} milliseconds.", duration);
 
-    // Record the duration in Prometheus
-    //gauge.Set(static_cast<double>(duration));
+    // Dump the run for offline inspection (rrt_3d --render); taken after planning, off the planner's clock
+    if (!snapshotPath.empty()) {
+        std::string error;
+        TreeSnapshot snapshot = captureSnapshot(setup, rrt.getTree(), path, rrt.getMode() == PlannerMode::Connect ? &rrt.getGoalTree() : nullptr);
+        if (snapshot.save(snapshotPath, error)) {
+            logger->info("Saved snapshot of {} nodes to {}", snapshot.nodeCount(), snapshotPath);
+        } else {
+            logger->error("Could not save snapshot: {}", error);
+        }
+    }
+
+    // Record the duration and the planner's phase metrics in Prometheus
+    gauge.Set(static_cast<double>(duration));
+    metrics.publish(rrt.getStats(), rrt.getMetrics(), rrt.getTimeToFirstPath());
+
+    // Batch Jobs exit before they can be scraped: push when RRT_PUSHGATEWAY=host:port is set
+    if (const char* gateway = std::getenv("RRT_PUSHGATEWAY")) {
+        int status = metrics.push(gateway);
+        logger->info("Pushed metrics to {} (status {})", gateway, status);
+    }
+    // Otherwise keep the pull endpoint up for RRT_METRICS_HOLD_SECONDS so a scrape can see the run
+    if (const char* hold = std::getenv("RRT_METRICS_HOLD_SECONDS")) {
+        std::this_thread::sleep_for(std::chrono::seconds(std::atoi(hold)));
+    }
 
     // Visualize the RRT and obstacles
-    //visualize(setup, rrt.getRoot().get(), path);
+    //visualize(setup, rrt.getTree(), path);
+
+    // Drain the async log queue before exiting
+    spdlog::shutdown();
 
     return 0;
 }
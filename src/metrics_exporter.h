@@ -0,0 +1,99 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <prometheus/registry.h>
+#include <prometheus/counter.h>
+#include <prometheus/gauge.h>
+#include <prometheus/histogram.h>
+#include <prometheus/gateway.h>
+#include "planner_metrics.h"
+
+// Publishes finished planner runs to a prometheus registry: a duration histogram per phase,
+// sample outcome counters, an RRT* rewire counter and a time-to-first-path histogram. The planner only accumulates
+// plain per-thread counters; this is the one place that talks to prometheus-cpp.
+class PlannerMetricsExporter {
+    std::shared_ptr<prometheus::Registry> registry;
+    prometheus::Family<prometheus::Histogram>& phaseFamily;
+    prometheus::Family<prometheus::Counter>& sampleFamily;
+    prometheus::Family<prometheus::Counter>& runFamily;
+    prometheus::Histogram& firstPath;
+    // Not a sample outcome: a rewire moves an existing node, and one sample can cause several
+    prometheus::Counter& rewires;
+    std::vector<prometheus::Histogram*> phaseHistograms;
+
+    static prometheus::Histogram::BucketBoundaries phaseBounds() {
+        prometheus::Histogram::BucketBoundaries bounds;
+        for (int i = 0; i < DurationHistogram::Buckets; ++i) {
+            bounds.push_back(DurationHistogram::upperBound(i));
+        }
+        return bounds;
+    }
+
+public:
+    explicit PlannerMetricsExporter(std::shared_ptr<prometheus::Registry> registry)
+        : registry(registry),
+          phaseFamily(prometheus::BuildHistogram()
+                          .Name("rrt_phase_duration_seconds")
+                          .Help("Wall-clock time of one planner phase call")
+                          .Register(*registry)),
+          sampleFamily(prometheus::BuildCounter()
+                           .Name("rrt_samples_total")
+                           .Help("Samples drawn by the planner, by outcome")
+                           .Register(*registry)),
+          runFamily(prometheus::BuildCounter()
+                        .Name("rrt_runs_total")
+                        .Help("Planner runs, by whether a path was found")
+                        .Register(*registry)),
+          firstPath(prometheus::BuildHistogram()
+                        .Name("rrt_time_to_first_path_seconds")
+                        .Help("Time from start() until the first path was found")
+                        .Register(*registry)
+                        .Add({}, prometheus::Histogram::BucketBoundaries{0.001, 0.002, 0.005, 0.01, 0.02, 0.05,
+                                                                         0.1, 0.2, 0.5, 1, 2, 5})),
+          rewires(prometheus::BuildCounter()
+                      .Name("rrt_rewires_total")
+                      .Help("Nodes moved under a cheaper parent by RRT*")
+                      .Register(*registry)
+                      .Add({})) {
+        for (Phase phase : {Phase::Sample, Phase::Nearest, Phase::Collision, Phase::LockWait}) {
+            phaseHistograms.push_back(&phaseFamily.Add({{"phase", phaseName(phase)}}, phaseBounds()));
+        }
+    }
+
+    std::shared_ptr<prometheus::Registry> getRegistry() const { return registry; }
+
+    // Record one finished run; timeToFirstPath is 0 when no path was found
+    void publish(const PlannerStats& stats, const PhaseMetrics& metrics, double timeToFirstPath) {
+        for (Phase phase : {Phase::Sample, Phase::Nearest, Phase::Collision, Phase::LockWait}) {
+            const DurationHistogram& h = metrics[phase];
+            std::vector<double> increments;
+            for (int i = 0; i <= DurationHistogram::Buckets; ++i) {
+                increments.push_back(static_cast<double>(h.bucketCount(i)));
+            }
+            phaseHistograms[static_cast<int>(phase)]->ObserveMultiple(increments, h.sumSeconds());
+        }
+
+        sampleFamily.Add({{"outcome", "inserted"}}).Increment(static_cast<double>(stats.added));
+        sampleFamily.Add({{"outcome", "blocked"}}).Increment(static_cast<double>(stats.blocked));
+        sampleFamily.Add({{"outcome", "too_close"}}).Increment(static_cast<double>(stats.tooClose));
+        rewires.Increment(static_cast<double>(stats.rewired));
+
+        runFamily.Add({{"result", timeToFirstPath > 0 ? "solved" : "unsolved"}}).Increment();
+        if (timeToFirstPath > 0) firstPath.Observe(timeToFirstPath);
+    }
+
+    // Push everything to a Pushgateway at "host:port"; batch Jobs exit before a scrape could see them.
+    // Each pod pushes under its own instance label so runs do not overwrite each other.
+    // Returns the HTTP status, or -1 if the address is malformed.
+    int push(const std::string& address, const std::string& job = "rrt_project") const {
+        std::size_t colon = address.rfind(':');
+        if (colon == std::string::npos) return -1;
+        const char* host = std::getenv("HOSTNAME");
+        prometheus::Gateway gateway(address.substr(0, colon), address.substr(colon + 1), job,
+                                    {{"instance", host ? host : "local"}});
+        gateway.RegisterCollectable(registry);
+        return gateway.Push();
+    }
+};
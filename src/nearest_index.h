@@ -0,0 +1,369 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+// Nearest-neighbour index over the points of the RRT tree.
+// PointT only needs getX()/getY(); Item is whatever handle the planner uses for a node.
+template <typename PointT, typename Item>
+class NearestIndex {
+public:
+    virtual ~NearestIndex() = default;
+
+    // Register a point that has just been added to the tree
+    virtual void insert(const PointT& point, Item item) = 0;
+
+    // Closest item strictly nearer than 'distance'; on success 'distance' is updated
+    virtual bool nearest(const PointT& query, Item& item, double& distance) const = 0;
+
+    // All items within 'radius' of the query (appended to 'out')
+    virtual void radius(const PointT& query, double radius, std::vector<Item>& out) const = 0;
+
+    // Forget an item inserted at 'point'; serialized like insert(), and overlapping queries only
+    // on an index with concurrentReads()
+    virtual void remove(const PointT& point, Item item) = 0;
+
+    // Forget every item but keep the storage for the next inserts; never run during queries
+    virtual void clear() = 0;
+
+    // Items inserted and not removed
+    virtual std::size_t size() const = 0;
+
+    // Bytes allocated now, and the most the next few thousand inserts can add (for memory bounds)
+    virtual std::size_t memoryBytes() const = 0;
+    virtual std::size_t growthBytes() const = 0;
+
+    // True if queries may run while another thread inserts (inserts are always serialized)
+    virtual bool concurrentReads() const { return false; }
+};
+
+// Uniform grid of buckets, each covering cellSize x cellSize world units.
+// Nearest queries search rings of buckets outward from the query cell.
+// Inserts must be serialized by the caller, but queries are lock-free and may run
+// concurrently with an insert: entries are appended to chunked storage that never moves
+// and each bucket is a singly linked list whose head is published with release semantics.
+template <typename PointT, typename Item>
+class GridIndex : public NearestIndex<PointT, Item> {
+    // Entries keep float coordinates unless the points are double: exact for float points and
+    // for integer ones below 2^24, and a 16-byte entry for 32-bit items. Distances are still
+    // computed in double.
+    using Coord = std::conditional_t<std::is_same_v<std::decay_t<decltype(std::declval<PointT>().getX())>, double>, double, float>;
+    struct Entry {
+        Coord x, y;
+        Item item;
+        std::atomic<std::int32_t> next;  // atomic so remove() may unlink during queries
+    };
+
+    static constexpr std::int32_t None = -1;
+    static constexpr std::size_t EntryChunkBits = 12;
+    static constexpr std::size_t EntryChunkSize = std::size_t(1) << EntryChunkBits;
+    static constexpr std::size_t MaxEntryChunks = 4096;
+
+    double cellSize;
+    int cols, rows;
+    std::unique_ptr<std::atomic<std::int32_t>[]> heads;
+    std::unique_ptr<std::unique_ptr<Entry[]>[]> entries;
+    std::size_t entryChunks = 0;   // allocated, used or not (clear() keeps them)
+    std::atomic<std::size_t> count{0};
+    std::size_t removed = 0;
+    // Bounding box (in buckets) of the occupied part of the grid, used to stop ring expansion
+    std::atomic<int> minCol, maxCol, minRow, maxRow;
+
+    int colOf(double x) const { return std::clamp(static_cast<int>(x / cellSize), 0, cols - 1); }
+    int rowOf(double y) const { return std::clamp(static_cast<int>(y / cellSize), 0, rows - 1); }
+
+    const Entry& entry(std::int32_t e) const { return entries[e >> EntryChunkBits][e & (EntryChunkSize - 1)]; }
+    Entry& entry(std::int32_t e) { return entries[e >> EntryChunkBits][e & (EntryChunkSize - 1)]; }
+
+    template <typename Visit>
+    void visitBucket(int col, int row, Visit&& visit) const {
+        if (col < 0 || col >= cols || row < 0 || row >= rows) return;
+        for (std::int32_t e = heads[row * cols + col].load(std::memory_order_acquire); e != None; e = entry(e).next.load(std::memory_order_acquire)) {
+            visit(entry(e));
+        }
+    }
+
+    static void widen(std::atomic<int>& lo, std::atomic<int>& hi, int v) {
+        if (v < lo.load(std::memory_order_relaxed)) lo.store(v, std::memory_order_relaxed);
+        if (v > hi.load(std::memory_order_relaxed)) hi.store(v, std::memory_order_relaxed);
+    }
+
+public:
+    GridIndex(double length, double width, double cellSize)
+        : cellSize(cellSize),
+          cols(std::max(1, static_cast<int>(std::ceil(length / cellSize)))),
+          rows(std::max(1, static_cast<int>(std::ceil(width / cellSize)))),
+          heads(new std::atomic<std::int32_t>[static_cast<std::size_t>(cols) * rows]),
+          entries(new std::unique_ptr<Entry[]>[MaxEntryChunks]),
+          minCol(cols), maxCol(-1), minRow(rows), maxRow(-1) {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(cols) * rows; ++i) {
+            heads[i].store(None, std::memory_order_relaxed);
+        }
+    }
+
+    void insert(const PointT& point, Item item) override {
+        std::size_t n = count.load(std::memory_order_relaxed);
+        if ((n >> EntryChunkBits) >= MaxEntryChunks) return;
+        if ((n >> EntryChunkBits) == entryChunks) {
+            entries[entryChunks++].reset(new Entry[EntryChunkSize]);
+        }
+        int col = colOf(point.getX());
+        int row = rowOf(point.getY());
+        std::atomic<std::int32_t>& head = heads[row * cols + col];
+
+        Entry& e = entries[n >> EntryChunkBits][n & (EntryChunkSize - 1)];
+        e.x = static_cast<Coord>(point.getX());
+        e.y = static_cast<Coord>(point.getY());
+        e.item = item;
+        e.next.store(head.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        widen(minCol, maxCol, col);
+        widen(minRow, maxRow, row);
+        head.store(static_cast<std::int32_t>(n), std::memory_order_release);
+        count.store(n + 1, std::memory_order_release);
+    }
+
+    bool nearest(const PointT& query, Item& item, double& distance) const override {
+        if (count.load(std::memory_order_acquire) == 0) return false;
+        double qx = query.getX(), qy = query.getY();
+        int qc = colOf(qx), qr = rowOf(qy);
+        double best = distance * distance;
+        bool found = false;
+
+        auto visit = [&](const Entry& e) {
+            double dx = e.x - qx, dy = e.y - qy;
+            double d = dx * dx + dy * dy;
+            if (d < best) {
+                best = d;
+                item = e.item;
+                found = true;
+            }
+        };
+
+        // Furthest ring that can still contain an occupied bucket
+        int maxRing = std::max({qc - minCol.load(std::memory_order_relaxed), maxCol.load(std::memory_order_relaxed) - qc,
+                                qr - minRow.load(std::memory_order_relaxed), maxRow.load(std::memory_order_relaxed) - qr});
+        for (int ring = 0; ring <= maxRing; ++ring) {
+            // Everything in this ring is at least (ring - 1) cells away from the query
+            double bound = std::max(0, ring - 1) * cellSize;
+            if (found && bound * bound >= best) break;
+
+            if (ring == 0) {
+                visitBucket(qc, qr, visit);
+                continue;
+            }
+            for (int c = qc - ring; c <= qc + ring; ++c) {
+                visitBucket(c, qr - ring, visit);
+                visitBucket(c, qr + ring, visit);
+            }
+            for (int r = qr - ring + 1; r <= qr + ring - 1; ++r) {
+                visitBucket(qc - ring, r, visit);
+                visitBucket(qc + ring, r, visit);
+            }
+        }
+
+        if (found) distance = std::sqrt(best);
+        return found;
+    }
+
+    void radius(const PointT& query, double radius, std::vector<Item>& out) const override {
+        double qx = query.getX(), qy = query.getY();
+        double r2 = radius * radius;
+        int c0 = colOf(qx - radius), c1 = colOf(qx + radius);
+        int r0 = rowOf(qy - radius), r1 = rowOf(qy + radius);
+        for (int r = r0; r <= r1; ++r) {
+            for (int c = c0; c <= c1; ++c) {
+                visitBucket(c, r, [&](const Entry& e) {
+                    double dx = e.x - qx, dy = e.y - qy;
+                    if (dx * dx + dy * dy <= r2) out.push_back(e.item);
+                });
+            }
+        }
+    }
+
+    // Unlinks the entry from its bucket; its storage is not reused, so concurrent queries
+    // standing on it still find the rest of the bucket. Serialized like insert().
+    void remove(const PointT& point, Item item) override {
+        std::atomic<std::int32_t>& head = heads[rowOf(point.getY()) * cols + colOf(point.getX())];
+        std::int32_t e = head.load(std::memory_order_relaxed);
+        if (e != None && entry(e).item == item) {
+            head.store(entry(e).next.load(std::memory_order_relaxed), std::memory_order_release);
+            ++removed;
+            return;
+        }
+        for (; e != None; e = entry(e).next.load(std::memory_order_relaxed)) {
+            std::int32_t next = entry(e).next.load(std::memory_order_relaxed);
+            if (next != None && entry(next).item == item) {
+                entry(e).next.store(entry(next).next.load(std::memory_order_relaxed), std::memory_order_release);
+                ++removed;
+                return;
+            }
+        }
+    }
+
+    void clear() override {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(cols) * rows; ++i) {
+            heads[i].store(None, std::memory_order_relaxed);
+        }
+        minCol = cols;
+        maxCol = -1;
+        minRow = rows;
+        maxRow = -1;
+        removed = 0;
+        count.store(0, std::memory_order_release);
+    }
+
+    std::size_t size() const override { return count.load(std::memory_order_acquire) - removed; }
+    std::size_t memoryBytes() const override {
+        return static_cast<std::size_t>(cols) * rows * sizeof(heads[0]) + MaxEntryChunks * sizeof(entries[0]) +
+               entryChunks * EntryChunkSize * sizeof(Entry);
+    }
+    std::size_t growthBytes() const override { return EntryChunkSize * sizeof(Entry); }
+    bool concurrentReads() const override { return true; }
+};
+
+// Incremental k-d tree over the first Dims coordinates (x, y and, for Dims == 3, z).
+// Nodes are appended to a flat array and never rebalanced; with randomly sampled insert
+// order the expected depth stays logarithmic.
+template <typename PointT, typename Item, int Dims = 2>
+class KdTreeIndex : public NearestIndex<PointT, Item> {
+    static_assert(Dims == 2 || Dims == 3, "KdTreeIndex supports 2 or 3 dimensions");
+    static constexpr int None = -1;
+
+    struct KdNode {
+        double coord[Dims];
+        Item item;
+        int left = None, right = None;
+        bool removed = false;
+    };
+
+    std::vector<KdNode> nodes;
+    std::size_t removedCount = 0;
+
+    static void coordsOf(const PointT& p, double out[Dims]) {
+        out[0] = p.getX();
+        out[1] = p.getY();
+        if constexpr (Dims == 3) out[2] = p.getZ();
+    }
+
+    static double distance2(const double a[Dims], const double b[Dims]) {
+        double d = 0;
+        for (int i = 0; i < Dims; ++i) d += (a[i] - b[i]) * (a[i] - b[i]);
+        return d;
+    }
+
+    void nearestFrom(int n, int depth, const double q[Dims], Item& item, double& best, bool& found) const {
+        while (n != None) {
+            const KdNode& node = nodes[n];
+            double d = distance2(node.coord, q);
+            if (d < best && !node.removed) {
+                best = d;
+                item = node.item;
+                found = true;
+            }
+            int axis = depth % Dims;
+            double diff = q[axis] - node.coord[axis];
+            int nearSide = diff < 0 ? node.left : node.right;
+            int farSide = diff < 0 ? node.right : node.left;
+            // Only descend into the far side if the splitting plane is closer than the best so far
+            if (farSide != None && diff * diff < best) {
+                nearestFrom(farSide, depth + 1, q, item, best, found);
+            }
+            n = nearSide;
+            ++depth;
+        }
+    }
+
+    void radiusFrom(int n, int depth, const double q[Dims], double r2, std::vector<Item>& out) const {
+        while (n != None) {
+            const KdNode& node = nodes[n];
+            if (distance2(node.coord, q) <= r2 && !node.removed) out.push_back(node.item);
+            int axis = depth % Dims;
+            double diff = q[axis] - node.coord[axis];
+            int nearSide = diff < 0 ? node.left : node.right;
+            int farSide = diff < 0 ? node.right : node.left;
+            if (farSide != None && diff * diff <= r2) {
+                radiusFrom(farSide, depth + 1, q, r2, out);
+            }
+            n = nearSide;
+            ++depth;
+        }
+    }
+
+public:
+    KdTreeIndex() = default;
+
+    void insert(const PointT& point, Item item) override {
+        KdNode node;
+        coordsOf(point, node.coord);
+        node.item = item;
+        int id = static_cast<int>(nodes.size());
+        nodes.push_back(node);
+        if (id == 0) return;
+
+        int n = 0, depth = 0;
+        while (true) {
+            int axis = depth % Dims;
+            int& next = nodes[id].coord[axis] < nodes[n].coord[axis] ? nodes[n].left : nodes[n].right;
+            if (next == None) {
+                next = id;
+                return;
+            }
+            n = next;
+            ++depth;
+        }
+    }
+
+    bool nearest(const PointT& query, Item& item, double& distance) const override {
+        if (nodes.empty()) return false;
+        double q[Dims];
+        coordsOf(query, q);
+        double best = distance * distance;
+        bool found = false;
+        nearestFrom(0, 0, q, item, best, found);
+        if (found) distance = std::sqrt(best);
+        return found;
+    }
+
+    void radius(const PointT& query, double radius, std::vector<Item>& out) const override {
+        if (nodes.empty()) return;
+        double q[Dims];
+        coordsOf(query, q);
+        radiusFrom(0, 0, q, radius * radius, out);
+    }
+
+    // Removed nodes stay in place as split planes and are skipped by queries
+    void remove(const PointT& point, Item item) override {
+        double q[Dims];
+        coordsOf(point, q);
+        int n = nodes.empty() ? None : 0, depth = 0;
+        while (n != None) {
+            KdNode& node = nodes[n];
+            if (!node.removed && node.item == item) {
+                node.removed = true;
+                ++removedCount;
+                return;
+            }
+            // Equal coordinates go right on insert
+            n = q[depth % Dims] < node.coord[depth % Dims] ? node.left : node.right;
+            ++depth;
+        }
+    }
+
+    // The nodes' capacity is kept
+    void clear() override {
+        nodes.clear();
+        removedCount = 0;
+    }
+
+    std::size_t size() const override { return nodes.size() - removedCount; }
+    std::size_t memoryBytes() const override { return nodes.capacity() * sizeof(KdNode); }
+    // The node array doubles, holding both copies while it moves
+    std::size_t growthBytes() const override { return std::max<std::size_t>(nodes.capacity() * 2, 4096) * sizeof(KdNode); }
+};
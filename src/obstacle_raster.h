@@ -0,0 +1,224 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include "occupancy_grid.h"
+
+// A batch of obstacles in world coordinates: arbitrary simple polygons (any orientation,
+// convex or not) and circles. Polygon vertices are stored back to back in one array.
+class ObstacleBatch {
+public:
+    struct Bounds {
+        double x0, y0, x1, y1;
+    };
+
+private:
+    std::vector<double> xs, ys;
+    std::vector<std::uint32_t> firstVertex;  // polygon i uses vertices [firstVertex[i], firstVertex[i + 1])
+    std::vector<double> cx, cy, radii;
+
+public:
+    ObstacleBatch() : firstVertex{0} {}
+
+    // PointT only needs getX()/getY(); polygons with fewer than 3 vertices are ignored
+    template <typename PointT>
+    void addPolygon(const std::vector<PointT>& vertices) {
+        if (vertices.size() < 3) return;
+        for (const PointT& p : vertices) {
+            xs.push_back(p.getX());
+            ys.push_back(p.getY());
+        }
+        firstVertex.push_back(static_cast<std::uint32_t>(xs.size()));
+    }
+
+    // Rectangle of size w x h centred on (x, y), rotated by 'angle' radians
+    void addRotatedRect(double x, double y, double w, double h, double angle) {
+        double c = std::cos(angle), s = std::sin(angle);
+        double corners[4][2] = {{-w / 2, -h / 2}, {w / 2, -h / 2}, {w / 2, h / 2}, {-w / 2, h / 2}};
+        for (auto& corner : corners) {
+            xs.push_back(x + c * corner[0] - s * corner[1]);
+            ys.push_back(y + s * corner[0] + c * corner[1]);
+        }
+        firstVertex.push_back(static_cast<std::uint32_t>(xs.size()));
+    }
+
+    void addCircle(double x, double y, double radius) {
+        cx.push_back(x);
+        cy.push_back(y);
+        radii.push_back(radius);
+    }
+
+    std::size_t polygonCount() const { return firstVertex.size() - 1; }
+    std::size_t circleCount() const { return radii.size(); }
+    std::size_t size() const { return polygonCount() + circleCount(); }
+    bool empty() const { return size() == 0; }
+
+    std::size_t vertexBegin(std::size_t polygon) const { return firstVertex[polygon]; }
+    std::size_t vertexEnd(std::size_t polygon) const { return firstVertex[polygon + 1]; }
+    double vertexX(std::size_t v) const { return xs[v]; }
+    double vertexY(std::size_t v) const { return ys[v]; }
+    double circleX(std::size_t c) const { return cx[c]; }
+    double circleY(std::size_t c) const { return cy[c]; }
+    double circleRadius(std::size_t c) const { return radii[c]; }
+
+    // World-space bounding box of obstacle i; polygons come first, then circles
+    Bounds bounds(std::size_t i) const {
+        if (i < polygonCount()) {
+            Bounds b{std::numeric_limits<double>::max(), std::numeric_limits<double>::max(),
+                     std::numeric_limits<double>::lowest(), std::numeric_limits<double>::lowest()};
+            for (std::size_t v = vertexBegin(i); v < vertexEnd(i); ++v) {
+                b.x0 = std::min(b.x0, xs[v]);
+                b.y0 = std::min(b.y0, ys[v]);
+                b.x1 = std::max(b.x1, xs[v]);
+                b.y1 = std::max(b.y1, ys[v]);
+            }
+            return b;
+        }
+        std::size_t c = i - polygonCount();
+        return {cx[c] - radii[c], cy[c] - radii[c], cx[c] + radii[c], cy[c] + radii[c]};
+    }
+};
+
+// Scanline rasterizer from an ObstacleBatch into an OccupancyGrid.
+// Every cell the obstacle touches is marked, so rasterized obstacles are never thinner than
+// the real ones. Per grid row, a polygon covers the cells spanned by its edges inside the row
+// (cells holding part of the boundary) plus the even-odd spans of the row's centre line
+// (cells entirely inside); a circle covers its chord at the row's point closest to the centre.
+// Spans are written a word at a time with OccupancyGrid::fillRow, or with clearRow when the
+// batch describes space that became free (so a removed obstacle frees every cell it touched).
+// Rows are split into bands of one tile height; threads take whole bands, so no two threads
+// ever write the same word, and each band only visits the obstacles bucketed into it.
+class ObstacleRasterizer {
+public:
+    struct Result {
+        std::size_t obstacles = 0;
+        std::size_t cellsMarked = 0;  // cells whose state changed
+        double seconds = 0;
+        // Bounding box of the marked cells, for incremental updates of derived maps
+        int x0 = 0, y0 = 0, x1 = -1, y1 = -1;
+    };
+
+private:
+    const ObstacleBatch& batch;
+    OccupancyGrid& grid;
+    double cellSize, invCellSize;
+    bool clear;
+    // Per-thread scratch: centre-line crossings of the current polygon row
+    struct Scratch {
+        std::vector<double> crossings;
+    };
+
+    int cellOf(double v) const { return static_cast<int>(std::floor(v * invCellSize)); }
+
+    std::size_t span(int row, int x0, int x1) { return clear ? grid.clearRow(row, x0, x1) : grid.fillRow(row, x0, x1); }
+
+    std::size_t polygonRow(std::size_t polygon, int row, Scratch& scratch) {
+        double top = row * cellSize, bottom = (row + 1) * cellSize, mid = (row + 0.5) * cellSize;
+        std::size_t begin = batch.vertexBegin(polygon), end = batch.vertexEnd(polygon);
+        std::size_t added = 0;
+        scratch.crossings.clear();
+        for (std::size_t v = begin; v < end; ++v) {
+            std::size_t w = v + 1 < end ? v + 1 : begin;
+            double ax = batch.vertexX(v), ay = batch.vertexY(v);
+            double bx = batch.vertexX(w), by = batch.vertexY(w);
+            double lo = std::min(ay, by), hi = std::max(ay, by);
+            if (hi < top || lo > bottom) continue;
+
+            // Part of the edge inside the row: boundary cells
+            double xa = ax, xb = bx;
+            if (ay != by) {
+                double ta = std::clamp((top - ay) / (by - ay), 0.0, 1.0);
+                double tb = std::clamp((bottom - ay) / (by - ay), 0.0, 1.0);
+                xa = ax + ta * (bx - ax);
+                xb = ax + tb * (bx - ax);
+            }
+            added += span(row, cellOf(std::min(xa, xb)), cellOf(std::max(xa, xb)));
+
+            // Centre-line crossing, half-open in y so shared vertices count once
+            if ((ay <= mid) != (by <= mid)) {
+                scratch.crossings.push_back(ax + (mid - ay) / (by - ay) * (bx - ax));
+            }
+        }
+        std::sort(scratch.crossings.begin(), scratch.crossings.end());
+        for (std::size_t i = 0; i + 1 < scratch.crossings.size(); i += 2) {
+            added += span(row, cellOf(scratch.crossings[i]), cellOf(scratch.crossings[i + 1]));
+        }
+        return added;
+    }
+
+    std::size_t circleRow(std::size_t circle, int row) {
+        double x = batch.circleX(circle), y = batch.circleY(circle), r = batch.circleRadius(circle);
+        double nearest = std::clamp(y, row * cellSize, (row + 1) * cellSize);
+        double dy = nearest - y;
+        if (dy * dy > r * r) return 0;
+        double half = std::sqrt(r * r - dy * dy);
+        return span(row, cellOf(x - half), cellOf(x + half));
+    }
+
+public:
+    // clear: free the covered cells instead of marking them
+    ObstacleRasterizer(const ObstacleBatch& batch, OccupancyGrid& grid, double cellSize, bool clear = false)
+        : batch(batch), grid(grid), cellSize(cellSize), invCellSize(1.0 / cellSize), clear(clear) {}
+
+    // Rasterize the whole batch on 'threads' threads
+    Result run(int threads) {
+        auto begin = std::chrono::steady_clock::now();
+        Result result;
+        result.obstacles = batch.size();
+        if (batch.empty() || grid.rows() == 0) return result;
+
+        // Bucket obstacles by band; clip their row ranges to the grid
+        int bandRows = OccupancyGrid::TileSize;
+        int bands = (grid.rows() + bandRows - 1) / bandRows;
+        std::vector<std::vector<std::uint32_t>> bucket(bands);
+        result.x0 = grid.cols(), result.y0 = grid.rows();
+        for (std::size_t i = 0; i < batch.size(); ++i) {
+            ObstacleBatch::Bounds b = batch.bounds(i);
+            int r0 = std::max(0, cellOf(b.y0)), r1 = std::min(grid.rows() - 1, cellOf(b.y1));
+            int c0 = std::max(0, cellOf(b.x0)), c1 = std::min(grid.cols() - 1, cellOf(b.x1));
+            if (r0 > r1 || c0 > c1) continue;
+            for (int band = r0 / bandRows; band <= r1 / bandRows; ++band) {
+                bucket[band].push_back(static_cast<std::uint32_t>(i));
+            }
+            result.x0 = std::min(result.x0, c0), result.y0 = std::min(result.y0, r0);
+            result.x1 = std::max(result.x1, c1), result.y1 = std::max(result.y1, r1);
+        }
+
+        std::atomic<int> nextBand{0};
+        std::atomic<std::size_t> marked{0};
+        auto work = [&] {
+            Scratch scratch;
+            std::size_t local = 0;
+            for (int band; (band = nextBand.fetch_add(1, std::memory_order_relaxed)) < bands;) {
+                int bandTop = band * bandRows, bandBottom = std::min(grid.rows(), bandTop + bandRows) - 1;
+                for (std::uint32_t i : bucket[band]) {
+                    ObstacleBatch::Bounds b = batch.bounds(i);
+                    int r0 = std::max(bandTop, cellOf(b.y0)), r1 = std::min(bandBottom, cellOf(b.y1));
+                    for (int row = r0; row <= r1; ++row) {
+                        local += i < batch.polygonCount() ? polygonRow(i, row, scratch) : circleRow(i - batch.polygonCount(), row);
+                    }
+                }
+            }
+            marked.fetch_add(local, std::memory_order_relaxed);
+        };
+
+        std::vector<std::thread> workers;
+        for (int t = 1; t < std::min(threads, bands); ++t) {
+            workers.emplace_back(work);
+        }
+        work();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        result.cellsMarked = marked.load();
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return result;
+    }
+};
@@ -0,0 +1,151 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <bitset>
+#include "zeroed_pages.h"
+#include "tiled_map.h"
+
+// Bit-packed occupancy grid for the arena.
+// Cells are grouped into 64x64 tiles; a tile is 64 consecutive 64-bit words (one word per
+// tile row), so a neighbourhood of cells shares a few cache lines instead of one heap row
+// per grid line. Obstacles take 1 bit per cell.
+// Obstacle tiles are reached through a per-tile pointer, so a grid loaded from a .rrtmap file
+// uses the file's tiles in place: they are paged in from the mapping when first touched, and
+// its full tiles all share one read-only tile until a cell in them is cleared. Owned tiles live
+// in lazily zeroed pages, so memory follows the part of the arena in use.
+class OccupancyGrid {
+public:
+    static constexpr int TileBits = 6;
+    static constexpr int TileSize = 1 << TileBits;
+    static_assert(TileBits == tiled_map::TileBits, "OccupancyGrid tiles are the .rrtmap tiles");
+
+private:
+    // Shared by the full tiles of mapped grids; never written (writes that would not change it are skipped)
+    static constexpr const std::uint64_t* FullTile = tiled_map::FullTileWords.words;
+
+    int numCols = 0, numRows = 0;
+    int tilesX = 0, tilesY = 0;
+    // Words of tiles owned by the grid (all of them, or the empty and full tiles of a map file)
+    ZeroedPages<std::uint64_t> owned;
+    std::vector<std::uint64_t*> tiles;
+    std::unique_ptr<TiledMapFile> file;
+
+    std::size_t tileIndex(int x, int y) const { return static_cast<std::size_t>(y >> TileBits) * tilesX + (x >> TileBits); }
+    std::uint64_t& word(int x, int y) { return tiles[tileIndex(x, y)][y & (TileSize - 1)]; }
+    std::uint64_t word(int x, int y) const { return tiles[tileIndex(x, y)][y & (TileSize - 1)]; }
+    static std::uint64_t bitOf(int x) { return std::uint64_t(1) << (x & (TileSize - 1)); }
+    std::size_t wordCount() const { return static_cast<std::size_t>(tilesX) * tilesY * TileSize; }
+
+    // Word about to have bits cleared: a shared full tile first gets its own words
+    std::uint64_t& writableWord(int x, int y) {
+        std::uint64_t*& tile = tiles[tileIndex(x, y)];
+        if (tile == FullTile) {
+            tile = owned.data() + (tileIndex(x, y) << TileBits);
+            std::copy_n(FullTile, TileSize, tile);
+        }
+        return tile[y & (TileSize - 1)];
+    }
+
+    // Mask of cells x..last of one word, x and last in the same tile
+    static std::uint64_t spanMask(int x, int last) {
+        int width = last - x + 1;
+        return (width == TileSize ? ~std::uint64_t(0) : ((std::uint64_t(1) << width) - 1)) << (x & (TileSize - 1));
+    }
+
+public:
+    OccupancyGrid() = default;
+    OccupancyGrid(int cols, int rows)
+        : numCols(cols), numRows(rows),
+          tilesX((cols + TileSize - 1) >> TileBits), tilesY((rows + TileSize - 1) >> TileBits),
+          owned(wordCount()), tiles(static_cast<std::size_t>(tilesX) * tilesY) {
+        for (std::size_t t = 0; t < tiles.size(); ++t) {
+            tiles[t] = owned.data() + (t << TileBits);
+        }
+    }
+
+    // Grid backed by a mapped .rrtmap file. Data tiles stay in the (private) mapping and empty
+    // tiles use the grid's own zeroed words, so every tile but the shared full one is writable.
+    explicit OccupancyGrid(std::unique_ptr<TiledMapFile> map)
+        : OccupancyGrid(map->cols(), map->rows()) {
+        for (std::size_t t = 0; t < tiles.size(); ++t) {
+            std::uint32_t entry = map->entry(t);
+            if (entry == tiled_map::FullTile) {
+                tiles[t] = const_cast<std::uint64_t*>(FullTile);
+            } else if (entry != tiled_map::EmptyTile) {
+                tiles[t] = map->tileWords(entry);
+            }
+        }
+        file = std::move(map);
+    }
+
+    // Null unless the grid was loaded from a map file
+    const TiledMapFile* mapFile() const { return file.get(); }
+
+    int cols() const { return numCols; }
+    int rows() const { return numRows; }
+    bool inBounds(int x, int y) const { return x >= 0 && x < numCols && y >= 0 && y < numRows; }
+
+    // Cell accessors; callers are expected to check inBounds first
+    bool isObstacle(int x, int y) const { return word(x, y) & bitOf(x); }
+    void setObstacle(int x, int y, bool value) {
+        if (isObstacle(x, y) == value) return;
+        std::uint64_t& w = writableWord(x, y);
+        w = value ? (w | bitOf(x)) : (w & ~bitOf(x));
+    }
+
+    // Mark cells x0..x1 of row y as obstacles (clipped to the grid) and return how many were
+    // free before. Rows never share words, so different rows may be filled concurrently.
+    std::size_t fillRow(int y, int x0, int x1) {
+        if (y < 0 || y >= numRows) return 0;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, numCols - 1);
+        std::size_t added = 0;
+        for (int x = x0; x <= x1;) {
+            int last = std::min(x1, x | (TileSize - 1));
+            std::uint64_t mask = spanMask(x, last);
+            std::uint64_t& w = word(x, y);
+            if ((w & mask) != mask) {
+                added += std::bitset<TileSize>(mask & ~w).count();
+                w |= mask;
+            }
+            x = last + 1;
+        }
+        return added;
+    }
+
+    // Free cells x0..x1 of row y (clipped to the grid) and return how many were obstacles.
+    // Rows of one tile share its words only when a full tile is copied, so unlike fillRow
+    // concurrent callers must work on different tiles.
+    std::size_t clearRow(int y, int x0, int x1) {
+        if (y < 0 || y >= numRows) return 0;
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, numCols - 1);
+        std::size_t removed = 0;
+        for (int x = x0; x <= x1;) {
+            int last = std::min(x1, x | (TileSize - 1));
+            std::uint64_t mask = spanMask(x, last);
+            if (word(x, y) & mask) {
+                std::uint64_t& w = writableWord(x, y);
+                removed += std::bitset<TileSize>(mask & w).count();
+                w &= ~mask;
+            }
+            x = last + 1;
+        }
+        return removed;
+    }
+
+    // Obstacle bits of the 64 cells of row y in x's tile column (bit i: column (x & ~63) + i),
+    // for copying the grid a tile row at a time
+    std::uint64_t rowWord(int x, int y) const { return word(x, y); }
+
+    // Free and inside the grid
+    bool isFree(int x, int y) const { return inBounds(x, y) && !isObstacle(x, y); }
+
+    // Bytes spanned by the bit plane and the tile table (resident memory is the touched part)
+    std::size_t memoryBytes() const {
+        return wordCount() * sizeof(std::uint64_t) + tiles.size() * sizeof(std::uint64_t*);
+    }
+};
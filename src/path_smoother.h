@@ -0,0 +1,320 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <random>
+#include <thread>
+#include <chrono>
+#include <utility>
+#include <type_traits>
+#include "collision_checker.h"
+#include "voxel_map.h"
+
+struct SmoothingOptions {
+    int threads = 1;
+    // Batches of random partial shortcuts tried after the greedy pass, and their size
+    int rounds = 8;
+    int candidatesPerRound = 256;
+    // Fit a Catmull-Rom spline through the shortcut path, sampled every 'splineStep' world units
+    // (0: one grid cell); pieces that would collide stay straight
+    bool spline = false;
+    double splineStep = 0;
+    unsigned seed = 1;
+};
+
+struct SmoothingReport {
+    std::size_t waypointsBefore = 0, waypointsAfter = 0;
+    double lengthBefore = 0, lengthAfter = 0;
+    std::size_t shortcuts = 0;         // random shortcuts spliced in
+    std::size_t straightPieces = 0;    // spline pieces that collided and were kept straight
+    std::size_t edgesChecked = 0;
+    double seconds = 0;
+};
+
+// Post-processing of a planner path against a CollisionChecker, or, for a path through a 3D
+// arena, against the planner's (dilated) VoxelMap; the 2D grid has no z, so a 3D path checked
+// against it could be shortcut through a box. Shortcut and spline points keep their z.
+//  1. Greedy shortcutting: from each kept waypoint, the farthest later waypoint it can see
+//     becomes the next one. Candidates are checked a batch at a time, so one pass costs about
+//     one edge check per input waypoint.
+//  2. Randomized shortcutting: batches of random pairs of points on the path (anywhere along
+//     its segments, not just at waypoints); the free ones that shorten the path are spliced in,
+//     best first, as long as they do not overlap.
+//  3. Optional spline: a centripetal Catmull-Rom curve through the waypoints, sampled finely;
+//     a piece between two waypoints whose samples collide keeps the straight segment.
+// Edge batches are split across 'threads' threads; the checker fills its tiles under its own
+// lock and the voxel map is read only, so concurrent checks are safe. Coordinates are rounded to the point type, and every
+// edge of the result is checked after rounding.
+template <typename PointT>
+class PathSmoother {
+    using Coord = decltype(std::declval<const PointT&>().getX());
+    // Fewer edges than this per extra thread are not worth starting it for
+    static constexpr std::size_t MinEdgesPerThread = 64;
+    static constexpr std::size_t GreedyBatch = 64;
+
+    const CollisionChecker& checker;
+    const VoxelMap* volume;
+    SmoothingOptions options;
+    double cellSize;
+    std::mt19937 gen;
+    EdgeBatch batch;
+    std::vector<std::pair<PointT, PointT>> volumeEdges;   // the batch, when checked in 3D
+    std::vector<std::uint8_t> edgeFree;
+    std::size_t checked = 0;
+
+    static double distance(const PointT& a, const PointT& b) {
+        double planar = std::hypot(static_cast<double>(a.getX()) - b.getX(), static_cast<double>(a.getY()) - b.getY());
+        double dz = static_cast<double>(a.getZ()) - b.getZ();
+        return dz == 0 ? planar : std::hypot(planar, dz);
+    }
+
+    static PointT at(double x, double y, double z) {
+        if constexpr (std::is_integral<Coord>::value) {
+            return PointT(static_cast<Coord>(std::lround(x)), static_cast<Coord>(std::lround(y)), static_cast<Coord>(std::lround(z)));
+        } else {
+            return PointT(static_cast<Coord>(x), static_cast<Coord>(y), static_cast<Coord>(z));
+        }
+    }
+
+    void clearBatch() {
+        batch.clear();
+        volumeEdges.clear();
+    }
+    std::size_t batchSize() const { return volume ? volumeEdges.size() : batch.size(); }
+    void add(const PointT& a, const PointT& b) {
+        if (volume) {
+            volumeEdges.emplace_back(a, b);
+        } else {
+            batch.add(a.getX(), a.getY(), b.getX(), b.getY());
+        }
+    }
+
+    void checkRange(std::size_t begin, std::size_t end) {
+        if (!volume) {
+            checker.checkBatch(batch, begin, end, edgeFree.data());
+            return;
+        }
+        double inv = 1.0 / cellSize;
+        for (std::size_t i = begin; i < end; ++i) {
+            const PointT& a = volumeEdges[i].first;
+            const PointT& b = volumeEdges[i].second;
+            edgeFree[i] = volume->segmentFree(a.getX() * inv, a.getY() * inv, a.getZ() * inv, b.getX() * inv, b.getY() * inv, b.getZ() * inv);
+        }
+    }
+
+    // Check the whole batch into 'edgeFree'
+    void checkBatch() {
+        std::size_t n = batchSize();
+        edgeFree.assign(n, 0);
+        checked += n;
+        int workers = static_cast<int>(std::min<std::size_t>(std::max(1, options.threads), std::max<std::size_t>(1, n / MinEdgesPerThread)));
+        if (workers == 1) {
+            checkRange(0, n);
+            return;
+        }
+        std::vector<std::thread> threads;
+        std::size_t share = (n + workers - 1) / workers;
+        for (int w = 1; w < workers; ++w) {
+            std::size_t begin = std::min(n, w * share), end = std::min(n, begin + share);
+            threads.emplace_back([this, begin, end] { checkRange(begin, end); });
+        }
+        checkRange(0, std::min(n, share));
+        for (auto& thread : threads) {
+            thread.join();
+        }
+    }
+
+    std::vector<PointT> greedy(const std::vector<PointT>& path) {
+        std::vector<PointT> out{path.front()};
+        std::size_t anchor = 0, n = path.size();
+        while (anchor + 1 < n) {
+            // The next waypoint is always reachable: it is an edge of the input path
+            std::size_t best = anchor + 1;
+            std::size_t window = GreedyBatch * std::max(1, options.threads);
+            for (std::size_t from = anchor + 2; from < n; from += window) {
+                std::size_t to = std::min(n, from + window);
+                clearBatch();
+                for (std::size_t j = from; j < to; ++j) add(path[anchor], path[j]);
+                checkBatch();
+                std::size_t farthest = 0;
+                for (std::size_t j = from; j < to; ++j) {
+                    if (edgeFree[j - from]) farthest = j;
+                }
+                if (farthest == 0) break;
+                best = farthest;
+                // Visibility rarely comes back once a whole batch is blocked past the last free one
+                if (farthest + 1 < to) break;
+            }
+            out.push_back(path[best]);
+            anchor = best;
+        }
+        return out;
+    }
+
+    struct Shortcut {
+        std::size_t first, last;  // replaces the waypoints strictly between them
+        PointT a, b;
+        double gain;
+    };
+
+    // One batch of random shortcuts; returns how many were spliced in
+    std::size_t shortcutRound(std::vector<PointT>& path) {
+        std::size_t segments = path.size() - 1;
+        if (segments < 2) return 0;
+        std::vector<double> along(path.size(), 0);
+        for (std::size_t i = 1; i < path.size(); ++i) along[i] = along[i - 1] + distance(path[i - 1], path[i]);
+        std::uniform_real_distribution<> position(0, along.back());
+
+        // a lies on segment first, b on segment last - 1; the path between them is replaced by
+        // first -> a -> b -> last, so all three edges are checked
+        std::vector<Shortcut> candidates;
+        clearBatch();
+        for (int c = 0; c < options.candidatesPerRound; ++c) {
+            double s = position(gen), t = position(gen);
+            if (s > t) std::swap(s, t);
+            std::size_t i = std::upper_bound(along.begin(), along.end(), s) - along.begin() - 1;
+            std::size_t j = std::upper_bound(along.begin(), along.end(), t) - along.begin();
+            i = std::min(i, segments - 1);
+            j = std::min(j, path.size() - 1);
+            if (j < i + 2) continue;
+            auto point = [&](std::size_t k, double u) {
+                double f = along[k + 1] > along[k] ? (u - along[k]) / (along[k + 1] - along[k]) : 0;
+                return at(path[k].getX() + f * (path[k + 1].getX() - path[k].getX()), path[k].getY() + f * (path[k + 1].getY() - path[k].getY()),
+                          path[k].getZ() + f * (path[k + 1].getZ() - path[k].getZ()));
+            };
+            PointT a = point(i, s), b = point(j - 1, t);
+            double before = along[j] - along[i];
+            double after = distance(path[i], a) + distance(a, b) + distance(b, path[j]);
+            if (after >= before - 1e-9) continue;
+            candidates.push_back({i, j, a, b, before - after});
+            add(path[i], a);
+            add(a, b);
+            add(b, path[j]);
+        }
+        if (candidates.empty()) return 0;
+        checkBatch();
+
+        std::vector<std::size_t> accepted;
+        for (std::size_t c = 0; c < candidates.size(); ++c) {
+            if (edgeFree[3 * c] && edgeFree[3 * c + 1] && edgeFree[3 * c + 2]) accepted.push_back(c);
+        }
+        std::sort(accepted.begin(), accepted.end(), [&](std::size_t x, std::size_t y) { return candidates[x].gain > candidates[y].gain; });
+        std::vector<Shortcut> taken;
+        for (std::size_t c : accepted) {
+            const Shortcut& s = candidates[c];
+            bool overlaps = std::any_of(taken.begin(), taken.end(), [&](const Shortcut& t) { return s.first < t.last && t.first < s.last; });
+            if (!overlaps) taken.push_back(s);
+        }
+        std::sort(taken.begin(), taken.end(), [](const Shortcut& x, const Shortcut& y) { return x.first < y.first; });
+
+        std::vector<PointT> out;
+        out.reserve(path.size());
+        std::size_t next = 0;
+        for (const Shortcut& s : taken) {
+            out.insert(out.end(), path.begin() + next, path.begin() + s.first + 1);
+            if (!(s.a == path[s.first])) out.push_back(s.a);
+            if (!(s.b == s.a) && !(s.b == path[s.last])) out.push_back(s.b);
+            next = s.last;
+        }
+        out.insert(out.end(), path.begin() + next, path.end());
+        path.swap(out);
+        return taken.size();
+    }
+
+    std::vector<PointT> spline(const std::vector<PointT>& path, std::size_t& straight) {
+        double step = options.splineStep > 0 ? options.splineStep : cellSize;
+        std::size_t pieces = path.size() - 1;
+        // Samples of every piece, excluding its start waypoint
+        std::vector<std::vector<PointT>> samples(pieces);
+        clearBatch();
+        std::vector<std::size_t> firstEdge(pieces + 1, 0);
+        for (std::size_t k = 0; k < pieces; ++k) {
+            const PointT& p0 = path[k > 0 ? k - 1 : k];
+            const PointT& p1 = path[k];
+            const PointT& p2 = path[k + 1];
+            const PointT& p3 = path[k + 2 < path.size() ? k + 2 : k + 1];
+            // Centripetal parametrisation (alpha = 1/2) never cusps or self-intersects within a piece
+            double t0 = 0;
+            double t1 = t0 + std::sqrt(std::max(distance(p0, p1), 1e-9));
+            double t2 = t1 + std::sqrt(std::max(distance(p1, p2), 1e-9));
+            double t3 = t2 + std::sqrt(std::max(distance(p2, p3), 1e-9));
+            int count = std::max(1, static_cast<int>(std::ceil(distance(p1, p2) / step)));
+            auto lerp = [](double ta, double tb, double t, double a, double b) {
+                return tb > ta ? ((tb - t) * a + (t - ta) * b) / (tb - ta) : a;
+            };
+            PointT previous = p1;
+            for (int i = 1; i <= count; ++i) {
+                PointT q = p2;
+                if (i < count) {
+                    double t = t1 + (t2 - t1) * i / count;
+                    double c[3];
+                    for (int axis = 0; axis < 3; ++axis) {
+                        auto v = [&](const PointT& p) { return static_cast<double>(axis == 0 ? p.getX() : axis == 1 ? p.getY() : p.getZ()); };
+                        double a1 = lerp(t0, t1, t, v(p0), v(p1)), a2 = lerp(t1, t2, t, v(p1), v(p2)), a3 = lerp(t2, t3, t, v(p2), v(p3));
+                        double b1 = lerp(t0, t2, t, a1, a2), b2 = lerp(t1, t3, t, a2, a3);
+                        c[axis] = lerp(t1, t2, t, b1, b2);
+                    }
+                    q = at(c[0], c[1], c[2]);
+                }
+                if (q == previous) continue;
+                samples[k].push_back(q);
+                add(previous, q);
+                previous = q;
+            }
+            firstEdge[k + 1] = batchSize();
+        }
+        checkBatch();
+
+        std::vector<PointT> out{path.front()};
+        for (std::size_t k = 0; k < pieces; ++k) {
+            bool clear = std::all_of(edgeFree.begin() + firstEdge[k], edgeFree.begin() + firstEdge[k + 1], [](std::uint8_t f) { return f != 0; });
+            if (clear) {
+                out.insert(out.end(), samples[k].begin(), samples[k].end());
+            } else {
+                ++straight;
+                out.push_back(path[k + 1]);
+            }
+        }
+        return out;
+    }
+
+public:
+    // cellSize: the checker's grid cell size in world units (the default spline step), which is
+    // also the voxel size. volume: the planner's voxel map when the path is 3D (getVolume()),
+    // or null to check against the 2D checker.
+    PathSmoother(const CollisionChecker& checker, double cellSize, SmoothingOptions options = SmoothingOptions(),
+                 const VoxelMap* volume = nullptr)
+        : checker(checker), volume(volume), options(options), cellSize(cellSize), gen(options.seed) {}
+
+    static double length(const std::vector<PointT>& path) {
+        double total = 0;
+        for (std::size_t i = 1; i < path.size(); ++i) total += distance(path[i - 1], path[i]);
+        return total;
+    }
+
+    // Shortcut (and optionally smooth) a collision-free path from the planner
+    std::vector<PointT> smooth(const std::vector<PointT>& path, SmoothingReport& report) {
+        auto begin = std::chrono::steady_clock::now();
+        checked = 0;
+        report = SmoothingReport();
+        report.waypointsBefore = path.size();
+        report.lengthBefore = length(path);
+
+        std::vector<PointT> out = path;
+        if (path.size() > 2) {
+            out = greedy(path);
+            for (int round = 0; round < options.rounds; ++round) {
+                report.shortcuts += shortcutRound(out);
+            }
+            if (options.spline && out.size() > 2) out = spline(out, report.straightPieces);
+        }
+
+        report.waypointsAfter = out.size();
+        report.lengthAfter = length(out);
+        report.edgesChecked = checked;
+        report.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        return out;
+    }
+};
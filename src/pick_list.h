@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <limits>
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include "plan_options.h"
+
+// Result of RRTPlanner::planStops: one tree from the start (stop 0) that reached every pick.
+// Any two stops are joined through the tree, up from one to the branch they share and down to
+// the other, so all pairwise legs come from the one tree growth.
+template <typename PointT>
+struct PickListOutcome {
+    PlanStatus status = PlanStatus::Infeasible;
+    std::vector<PointT> stops;    // the start, then the picks in the order given
+    // Tree path from the start to the node that reached each stop; empty for a stop not reached
+    std::vector<std::vector<PointT>> stopPaths;
+    // stops.size() x stops.size(), row-major: leg costs (infinity where a stop was not reached),
+    // and how many leading points the two stop paths share
+    std::vector<double> legCosts;
+    std::vector<std::uint32_t> sharedPoints;
+    // Visiting order from stop 0 by leg costs, and the total cost of that order and of the picks
+    // in the order given (infinity unless every stop was reached)
+    std::vector<std::size_t> order;
+    double orderedCost = std::numeric_limits<double>::infinity();
+    double listedCost = std::numeric_limits<double>::infinity();
+    PlannerStats stats;
+    std::size_t nodes = 0;
+    double seconds = 0;
+
+    std::size_t size() const { return stops.size(); }
+    double legCost(std::size_t from, std::size_t to) const { return legCosts[from * stops.size() + to]; }
+
+    // Waypoints from stop 'from' to stop 'to' (tree nodes, as for a single plan); empty if either
+    // stop was not reached
+    std::vector<PointT> leg(std::size_t from, std::size_t to) const {
+        std::vector<PointT> path;
+        const std::vector<PointT>& a = stopPaths[from];
+        const std::vector<PointT>& b = stopPaths[to];
+        if (a.empty() || b.empty()) return path;
+        std::size_t shared = sharedPoints[from * stops.size() + to];
+        path.assign(a.rbegin(), a.rend() - (shared - 1));
+        path.insert(path.end(), b.begin() + shared, b.end());
+        return path;
+    }
+};
+
+// Open tour from stop 0 through every stop, for a square cost matrix: nearest neighbour, then
+// 2-opt until no reversal of a stretch shortens it. Fine for pick lists of tens of stops.
+inline std::vector<std::size_t> orderStops(const std::vector<double>& costs, std::size_t n) {
+    std::vector<std::size_t> order;
+    if (n == 0) return order;
+    std::vector<bool> visited(n);
+    order.push_back(0);
+    visited[0] = true;
+    while (order.size() < n) {
+        std::size_t from = order.back(), next = n;
+        for (std::size_t s = 0; s < n; ++s) {
+            if (!visited[s] && (next == n || costs[from * n + s] < costs[from * n + next])) next = s;
+        }
+        visited[next] = true;
+        order.push_back(next);
+    }
+    // Reversing order[i..j] swaps edges (i-1, i) and (j, j+1) for (i-1, j) and (i, j+1); the tour
+    // is open, so a stretch that runs to the end only changes its first edge
+    for (bool improved = true; improved;) {
+        improved = false;
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            for (std::size_t j = i + 1; j < n; ++j) {
+                double before = costs[order[i - 1] * n + order[i]] + (j + 1 < n ? costs[order[j] * n + order[j + 1]] : 0);
+                double after = costs[order[i - 1] * n + order[j]] + (j + 1 < n ? costs[order[i] * n + order[j + 1]] : 0);
+                if (after < before - 1e-9) {
+                    std::reverse(order.begin() + i, order.begin() + j + 1);
+                    improved = true;
+                }
+            }
+        }
+    }
+    return order;
+}
+
+inline double tourCost(const std::vector<double>& costs, std::size_t n, const std::vector<std::size_t>& order) {
+    double total = 0;
+    for (std::size_t i = 1; i < order.size(); ++i) total += costs[order[i - 1] * n + order[i]];
+    return total;
+}
@@ -0,0 +1,114 @@
+#pragma once
+#include <vector>
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <limits>
+#include <utility>
+#include <functional>
+#include <cstddef>
+#include "planner_metrics.h"
+
+// Lets one thread stop the plans running on others. requestStop() is sticky (until reset()) and
+// cancels every plan() watching the token at once, so a stop never waits for a polling interval.
+class StopToken {
+    std::atomic<bool> stopped{false};
+    std::mutex mutex;
+    std::vector<std::pair<const void*, std::function<void()>>> watchers;
+
+public:
+    StopToken() = default;
+    StopToken(const StopToken&) = delete;
+    StopToken& operator=(const StopToken&) = delete;
+
+    void requestStop() {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopped = true;
+        for (auto& watcher : watchers) watcher.second();
+    }
+    bool stopRequested() const { return stopped.load(std::memory_order_relaxed); }
+    void reset() { stopped = false; }
+
+    // Call 'onStop' when a stop is requested, or right away if one already was; until unwatch(owner)
+    void watch(const void* owner, std::function<void()> onStop) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (stopped) onStop();
+        watchers.emplace_back(owner, std::move(onStop));
+    }
+    void unwatch(const void* owner) {
+        std::lock_guard<std::mutex> lock(mutex);
+        watchers.erase(std::remove_if(watchers.begin(), watchers.end(), [owner](const auto& w) { return w.first == owner; }),
+                       watchers.end());
+    }
+};
+
+enum class PlanStatus {
+    Found,        // a path to the target
+    Timeout,      // a budget ran out first (time, nodes, or the tree's node storage)
+    Cancelled,    // the stop token was triggered first
+    Infeasible,   // no path exists: an endpoint is blocked, or the target is cut off from the start
+    InvalidOptions  // the options cannot work (a memory bound below what the trees need to grow); nothing ran
+};
+
+inline const char* planStatusName(PlanStatus status) {
+    switch (status) {
+    case PlanStatus::Found: return "found";
+    case PlanStatus::Timeout: return "timeout";
+    case PlanStatus::Cancelled: return "cancelled";
+    case PlanStatus::Infeasible: return "infeasible";
+    case PlanStatus::InvalidOptions: return "invalid options";
+    }
+    return "unknown";
+}
+
+// Snapshot handed to the progress callback
+struct PlanProgress {
+    std::size_t nodes = 0;
+    double bestCost = std::numeric_limits<double>::infinity();    // infinity until there is a path
+    double closestDistance = std::numeric_limits<double>::infinity();  // start-tree node nearest the target
+    double seconds = 0;
+    std::size_t memoryBytes = 0;   // trees and their nearest-neighbour indexes
+};
+
+struct PlanOptions {
+    int threads = 1;
+    // Zero disables a budget. The node budget counts every node of the trees, including those
+    // kept from an earlier run. Star mode keeps improving the path until one of these runs out
+    // (with neither, it stops at the first path); they replace setBudget() for the call.
+    std::chrono::milliseconds timeBudget{0};
+    std::size_t nodeBudget = 0;
+    // Memory bound (zero disables each): once the trees hold maxTreeNodes live nodes, or would
+    // outgrow maxTreeBytes of tree and index storage, the workers pause while the branches least
+    // likely to matter are pruned to three quarters of the limit, and then grow on into the freed
+    // slots. A found path is never pruned. Unlike nodeBudget this never ends the plan.
+    std::size_t maxTreeNodes = 0;
+    std::size_t maxTreeBytes = 0;
+    // Optional; owned by the caller and must outlive the call
+    StopToken* stop = nullptr;
+    // Check up front that the target is connected to the start at all (one pass over the free
+    // cells of a 2D arena), so an unreachable target is Infeasible rather than a Timeout. Always
+    // done when there is neither a budget nor a stop token.
+    bool proveInfeasible = false;
+    // Called from the thread that called plan(), never from a worker, every progressInterval
+    // while the plan runs; the workers do not pay for it
+    std::function<void(const PlanProgress&)> onProgress;
+    std::chrono::milliseconds progressInterval{50};
+};
+
+template <typename PointT>
+struct PlanOutcome {
+    PlanStatus status = PlanStatus::Infeasible;
+    // Start to target; empty unless the status is Found
+    std::vector<PointT> path;
+    double cost = std::numeric_limits<double>::infinity();
+    // Otherwise the best partial progress: start to the start-tree node nearest the target
+    std::vector<PointT> partialPath;
+    double remainingDistance = std::numeric_limits<double>::infinity();
+    PlannerStats stats;
+    std::size_t nodes = 0;
+    std::size_t memoryBytes = 0;   // trees and their indexes at the end
+    std::size_t prunes = 0;        // times the memory bound was hit
+    double seconds = 0;
+    double timeToFirstPath = 0;
+};
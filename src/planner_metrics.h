@@ -0,0 +1,125 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+// Per-iteration outcomes of a run. Worker threads tally into a local copy and merge it once
+// when they exit, so the hot loop neither logs nor touches shared counters.
+struct PlannerStats {
+    std::uint64_t samples = 0, added = 0, blocked = 0, tooClose = 0, rewired = 0;
+    // Lazy mode: edges checked along candidate paths, and those that turned out blocked
+    std::uint64_t validated = 0, invalidated = 0;
+    // Nodes pruned to stay within a memory bound
+    std::uint64_t pruned = 0;
+
+    PlannerStats& operator+=(const PlannerStats& other) {
+        samples += other.samples;
+        added += other.added;
+        blocked += other.blocked;
+        tooClose += other.tooClose;
+        rewired += other.rewired;
+        validated += other.validated;
+        invalidated += other.invalidated;
+        pruned += other.pruned;
+        return *this;
+    }
+};
+
+// Outcome of repairing a live tree after an obstacle change (see RRTPlanner::addObstacles)
+struct RepairStats {
+    std::uint64_t tilesDropped = 0;    // collision tiles recomputed on demand
+    std::uint64_t edgesChecked = 0;    // tree edges near the change that were checked again
+    std::uint64_t edgesBlocked = 0;    // of those, edges the change blocked
+    std::uint64_t orphaned = 0;        // nodes cut off from the root by a blocked edge
+    std::uint64_t reattached = 0;      // orphans given a new collision-free parent
+    std::uint64_t dropped = 0;         // orphans that could not be reattached and left the tree
+    bool pathValid = false;            // a path to the target survived the change
+    double seconds = 0;
+};
+
+// Planner phases whose wall-clock time is recorded
+enum class Phase { Sample, Nearest, Collision, LockWait };
+constexpr int PhaseCount = 4;
+
+inline const char* phaseName(Phase phase) {
+    switch (phase) {
+    case Phase::Sample: return "sample";
+    case Phase::Nearest: return "nearest";
+    case Phase::Collision: return "collision";
+    case Phase::LockWait: return "lock_wait";
+    }
+    return "unknown";
+}
+
+// Duration histogram with power-of-two buckets from 64 ns to ~34 s (plus an overflow bucket).
+// Plain counters: each thread owns one and they are merged after the threads finish.
+class DurationHistogram {
+public:
+    static constexpr int Buckets = 30;
+    static constexpr int FirstBucketBits = 6;
+
+private:
+    std::uint64_t counts[Buckets + 1] = {};
+    std::uint64_t total = 0;
+    std::uint64_t sumNs = 0;
+
+public:
+    // Upper bound of bucket i in seconds
+    static double upperBound(int i) { return static_cast<double>(std::uint64_t(1) << (i + FirstBucketBits)) * 1e-9; }
+
+    void record(std::uint64_t ns) {
+        int bucket = 0;
+        for (std::uint64_t v = (ns > 0 ? ns - 1 : 0) >> FirstBucketBits; v > 0 && bucket < Buckets; v >>= 1) {
+            ++bucket;
+        }
+        ++counts[bucket];
+        ++total;
+        sumNs += ns;
+    }
+
+    DurationHistogram& operator+=(const DurationHistogram& other) {
+        for (int i = 0; i <= Buckets; ++i) counts[i] += other.counts[i];
+        total += other.total;
+        sumNs += other.sumNs;
+        return *this;
+    }
+
+    // Non-cumulative count of bucket i; bucket Buckets is everything above the last bound
+    std::uint64_t bucketCount(int i) const { return counts[i]; }
+    std::uint64_t count() const { return total; }
+    double sumSeconds() const { return static_cast<double>(sumNs) * 1e-9; }
+};
+
+struct PhaseMetrics {
+    DurationHistogram phases[PhaseCount];
+
+    DurationHistogram& operator[](Phase phase) { return phases[static_cast<int>(phase)]; }
+    const DurationHistogram& operator[](Phase phase) const { return phases[static_cast<int>(phase)]; }
+
+    PhaseMetrics& operator+=(const PhaseMetrics& other) {
+        for (int i = 0; i < PhaseCount; ++i) phases[i] += other.phases[i];
+        return *this;
+    }
+};
+
+// Metrics of the planner thread running on this OS thread; null outside planner workers
+inline thread_local PhaseMetrics* threadMetrics = nullptr;
+
+// Records the lifetime of the scope into the calling thread's metrics, if it has any
+class PhaseTimer {
+    Phase phase;
+    std::chrono::steady_clock::time_point begin;
+
+public:
+    explicit PhaseTimer(Phase phase) : phase(phase) {
+        if (threadMetrics) begin = std::chrono::steady_clock::now();
+    }
+    ~PhaseTimer() {
+        if (threadMetrics) {
+            auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count();
+            (*threadMetrics)[phase].record(static_cast<std::uint64_t>(ns));
+        }
+    }
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+};
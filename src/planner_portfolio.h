@@ -0,0 +1,207 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include "arena_setup.h"
+
+// Sampler given to one planner of a portfolio
+enum class PortfolioSampler { Uniform, GoalBiased, Halton };
+
+// How one planner of a portfolio differs from the others (besides its seed)
+struct PortfolioEntry {
+    PlannerMode mode = PlannerMode::RRT;
+    PortfolioSampler sampler = PortfolioSampler::Uniform;
+    double stepScale = 1.0;    // multiplies the Setup's step_size
+};
+
+struct PortfolioOptions {
+    int planners = 4;
+    // Pool threads running the planners, one planner each at a time (0: hardware concurrency);
+    // planners beyond the pool start as threads become free
+    int threads = 0;
+    // Planner i is seeded with seed + i
+    unsigned seed = 1;
+    // Race: the first path cancels every other planner. With keepBest the portfolio instead runs
+    // until the deadline (RRT entries become anytime RRT* with the deadline as their budget) and
+    // returns the cheapest path. A deadline without keepBest only caps the race.
+    bool keepBest = false;
+    std::chrono::milliseconds deadline{0};
+    // Planner i uses entries[i % size]; empty means defaultEntries()
+    std::vector<PortfolioEntry> entries;
+};
+
+template <typename T>
+struct PortfolioResult {
+    // The planner whose path won, with its trees and stats; null if no planner found a path
+    std::unique_ptr<RRTPlanner<T>> planner;
+    int winner = -1;
+    std::string label;    // e.g. "connect/halton/x0.75"
+    double cost = std::numeric_limits<double>::infinity();
+    double seconds = 0;   // until the winning path was known (keepBest: until the portfolio stopped)
+    int started = 0;      // planners that ran before the portfolio stopped
+    int found = 0;        // of those, planners that found a path
+};
+
+// Speculative planning: several independent RRTPlanner instances on one Setup, differing in
+// seed, mode, sampler and step size, race on a pool of threads. Run-to-run variance of a single
+// planner is large, so the fastest of N independent planners is close to the head of the
+// distribution. The planners share the Setup (its arena and clearance map) but nothing else,
+// and only read it: they are built on a const Setup, so any per-planner state stays in the planner.
+template <typename T>
+class PlannerPortfolio {
+    const Setup<T>& setup;
+    PortfolioOptions options;
+
+    std::mutex mutex;
+    std::condition_variable done;
+    std::vector<std::unique_ptr<RRTPlanner<T>>> planners;
+    std::atomic<int> next{0};
+    int running = 0;
+    bool stopping = false;
+    PortfolioResult<T> result;
+    std::chrono::steady_clock::time_point begin;
+
+    const PortfolioEntry& entryOf(int i) const { return options.entries[i % options.entries.size()]; }
+
+    // With keepBest, RRT entries run as anytime RRT* until the deadline
+    PlannerMode modeOf(int i) const {
+        PlannerMode mode = entryOf(i).mode;
+        return options.keepBest && mode == PlannerMode::RRT ? PlannerMode::Star : mode;
+    }
+
+    std::unique_ptr<RRTPlanner<T>> makePlanner(int i) const {
+        const PortfolioEntry& entry = entryOf(i);
+        auto planner = std::make_unique<RRTPlanner<T>>(setup, options.seed + i);
+        PlannerMode mode = modeOf(i);
+        planner->setMode(mode);
+        if (mode == PlannerMode::Star) planner->setBudget(options.deadline);
+        planner->setStepSize(setup.step_size * entry.stepScale);
+        if (entry.sampler == PortfolioSampler::GoalBiased) {
+            planner->setSampler(std::make_unique<GoalBiasedSampler<Point<T>>>(setup.length, setup.width, setup.target, 0.05, setup.height));
+        } else if (entry.sampler == PortfolioSampler::Halton) {
+            planner->setSampler(std::make_unique<LowDiscrepancySampler<Point<T>>>(
+                setup.length, setup.width, LowDiscrepancySampler<Point<T>>::Sequence::Halton, setup.height));
+        }
+        return planner;
+    }
+
+    std::string label(int i) const {
+        return fmt::format("{}/{}/x{}", plannerModeName(modeOf(i)), planners[i]->getSampler().name(), entryOf(i).stepScale);
+    }
+
+    // Cancel every running planner; caller holds mutex
+    void stopAll() {
+        stopping = true;
+        for (auto& planner : planners) {
+            if (planner) planner->cancel();
+        }
+    }
+
+    // Pool thread: claim planners in order until they run out or the portfolio stops
+    void work() {
+        for (int i = next++; i < options.planners; i = next++) {
+            auto planner = makePlanner(i);
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                if (stopping) break;
+                planners[i] = std::move(planner);
+                ++result.started;
+            }
+            RRTPlanner<T>& current = *planners[i];
+            current.start(1);
+
+            std::unique_lock<std::mutex> lock(mutex);
+            double cost = current.getBestCost();
+            if (cost < std::numeric_limits<double>::infinity()) {
+                ++result.found;
+                if (cost < result.cost) {
+                    result.cost = cost;
+                    result.winner = i;
+                    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+                }
+                if (!options.keepBest && !stopping) {
+                    logger->info("Portfolio: planner {} ({}) found the first path, cost {:.1f}", i, label(i), cost);
+                    stopAll();
+                }
+            }
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        if (--running == 0) done.notify_all();
+    }
+
+public:
+    // The planner variants raced by default: both tree modes, three samplers and three step sizes
+    static std::vector<PortfolioEntry> defaultEntries() {
+        return {
+            {PlannerMode::RRT, PortfolioSampler::Uniform, 1.0},
+            {PlannerMode::Connect, PortfolioSampler::Uniform, 1.0},
+            {PlannerMode::RRT, PortfolioSampler::GoalBiased, 1.5},
+            {PlannerMode::Connect, PortfolioSampler::Halton, 0.75},
+            {PlannerMode::RRT, PortfolioSampler::Halton, 1.0},
+            {PlannerMode::Connect, PortfolioSampler::GoalBiased, 1.5},
+        };
+    }
+
+    PlannerPortfolio(const Setup<T>& setup, PortfolioOptions options) : setup(setup), options(std::move(options)) {
+        if (this->options.entries.empty()) this->options.entries = defaultEntries();
+        this->options.planners = std::max(1, this->options.planners);
+    }
+
+    PlannerPortfolio(const PlannerPortfolio&) = delete;
+    PlannerPortfolio& operator=(const PlannerPortfolio&) = delete;
+
+    // Race the planners and hand back the winner. Without a deadline this returns once a planner
+    // has a path (keepBest: once every planner has finished its run).
+    PortfolioResult<T> run() {
+        begin = std::chrono::steady_clock::now();
+        result = PortfolioResult<T>();
+        next = 0;
+        stopping = false;
+        planners.clear();
+        planners.resize(options.planners);
+        int threads = options.threads > 0 ? options.threads : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        threads = std::min(threads, options.planners);
+        running = threads;
+
+        std::vector<std::thread> pool;
+        for (int i = 0; i < threads; ++i) {
+            pool.emplace_back(&PlannerPortfolio::work, this);
+        }
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            auto finished = [this] { return running == 0; };
+            if (options.deadline.count() > 0) {
+                if (!done.wait_for(lock, options.deadline, finished)) {
+                    logger->info("Portfolio: deadline of {} ms reached", options.deadline.count());
+                    stopAll();
+                }
+            } else {
+                done.wait(lock, finished);
+            }
+        }
+        for (auto& thread : pool) {
+            thread.join();
+        }
+
+        if (options.keepBest) {
+            result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        }
+        if (result.winner >= 0) {
+            result.label = label(result.winner);
+            result.planner = std::move(planners[result.winner]);
+            logger->info("Portfolio: {} of {} planners ran, {} found a path; planner {} ({}) won with cost {:.1f} after {:.3f} ms",
+                         result.started, options.planners, result.found, result.winner, result.label, result.cost, result.seconds * 1e3);
+        } else {
+            logger->error("Portfolio: none of the {} planners that ran found a path", result.started);
+        }
+        planners.clear();
+        return std::move(result);
+    }
+};
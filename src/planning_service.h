@@ -0,0 +1,371 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+#include <queue>
+#include <limits>
+#include <cstdint>
+#include "arena_setup.h"
+
+// Probabilistic roadmap over the free space of one arena, reused by every query.
+// Nodes are 2D points (the grid the roadmap is checked against is 2D), so for float or int
+// coordinates each takes 8 bytes. They are low-discrepancy samples that are free in the footprint-dilated grid; each node is
+// joined to all nodes within 'radius' whose connecting segment is collision free. Edges live
+// in one flat array threaded into per-node singly linked lists (like TreeStore's children),
+// so growing the roadmap only appends. Queries hold a shared lock; grow() takes it exclusively.
+template <typename T>
+class Roadmap {
+public:
+    using RoadmapId = std::uint32_t;
+
+    struct Edge {
+        RoadmapId to;
+        float cost;
+        std::int32_t next;
+    };
+
+    // Per-thread A* state. Entries are valid only when their stamp matches the current search,
+    // so a query never clears arrays sized to the whole roadmap.
+    struct Scratch {
+        std::vector<double> g;
+        std::vector<RoadmapId> parent;
+        std::vector<std::uint32_t> stamp, goalStamp;
+        std::vector<double> goalCost;
+        std::uint32_t search = 0;
+    };
+
+    static constexpr RoadmapId kNone = std::numeric_limits<RoadmapId>::max();
+
+private:
+    const CollisionChecker& checker;
+    double radius;
+    using Node = Point<T, 2>;
+
+    std::vector<Node> nodes;
+    std::vector<std::int32_t> firstEdge;
+    std::vector<Edge> edges;
+    GridIndex<Node, RoadmapId> index;
+    LowDiscrepancySampler<Node> sampler;
+    std::unique_ptr<SampleStream<Node>> stream;
+    mutable std::shared_mutex mutex;
+
+    void link(RoadmapId a, RoadmapId b, float cost) {
+        edges.push_back({b, cost, firstEdge[a]});
+        firstEdge[a] = static_cast<std::int32_t>(edges.size() - 1);
+        edges.push_back({a, cost, firstEdge[b]});
+        firstEdge[b] = static_cast<std::int32_t>(edges.size() - 1);
+    }
+
+    // Either end may be a roadmap node or a query's (3D, z ignored) endpoint
+    template <typename A, typename B>
+    bool segmentFree(const A& a, const B& b) const {
+        return checker.segmentFree(a.getX(), a.getY(), b.getX(), b.getY());
+    }
+
+    template <typename A, typename B>
+    static double distance(const A& a, const B& b) {
+        return std::hypot(static_cast<double>(a.getX()) - b.getX(), static_cast<double>(a.getY()) - b.getY());
+    }
+
+    // Free roadmap nodes within 'radius' of p that p can reach in a straight line
+    void attach(const Point<T>& p, std::vector<std::pair<RoadmapId, double>>& out) const {
+        std::vector<RoadmapId> near;
+        index.radius(Node(p), radius, near);
+        for (RoadmapId n : near) {
+            if (segmentFree(p, nodes[n])) out.emplace_back(n, distance(p, nodes[n]));
+        }
+    }
+
+public:
+    Roadmap(const CollisionChecker& checker, double length, double width, double radius, unsigned seed = 1)
+        : checker(checker), radius(radius),
+          index(length, width, radius), sampler(length, width) {
+        std::seed_seq seq{seed};
+        stream = std::make_unique<SampleStream<Node>>(seq);
+    }
+
+    // Add up to 'samples' free nodes, never growing past maxNodes, and connect them; returns
+    // how many were added
+    std::size_t grow(std::size_t samples, std::size_t maxNodes = std::numeric_limits<RoadmapId>::max()) {
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        std::vector<RoadmapId> near;
+        std::size_t before = nodes.size();
+        for (std::size_t i = 0; i < samples && nodes.size() < maxNodes; ++i) {
+            Node p = sampler.next(*stream);
+            if (!checker.pointFree(p.getX(), p.getY())) continue;
+
+            RoadmapId id = static_cast<RoadmapId>(nodes.size());
+            nodes.push_back(p);
+            firstEdge.push_back(-1);
+            near.clear();
+            index.radius(p, radius, near);
+            for (RoadmapId n : near) {
+                if (segmentFree(p, nodes[n])) link(id, n, static_cast<float>(distance(p, nodes[n])));
+            }
+            index.insert(p, id);
+        }
+        return nodes.size() - before;
+    }
+
+    // Can the robot stand at both ends? No roadmap growth helps a query that fails this
+    bool endpointsFree(const Point<T>& start, const Point<T>& goal) const {
+        return checker.pointFree(start.getX(), start.getY()) && checker.pointFree(goal.getX(), goal.getY());
+    }
+
+    std::size_t nodeCount() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return nodes.size();
+    }
+    std::size_t edgeCount() const {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return edges.size() / 2;
+    }
+
+    // A* from start to goal through the roadmap; false if either end cannot attach or the
+    // attached components are disconnected
+    bool query(const Point<T>& start, const Point<T>& goal, Scratch& s, std::vector<Point<T>>& path, double& cost) const {
+        path.clear();
+        if (!endpointsFree(start, goal)) return false;
+        if (segmentFree(start, goal)) {
+            path = {start, goal};
+            cost = distance(start, goal);
+            return true;
+        }
+
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        std::vector<std::pair<RoadmapId, double>> startLinks, goalLinks;
+        attach(start, startLinks);
+        attach(goal, goalLinks);
+        if (startLinks.empty() || goalLinks.empty()) return false;
+
+        std::size_t n = nodes.size();
+        if (s.g.size() < n) {
+            s.g.resize(n);
+            s.parent.resize(n);
+            s.stamp.resize(n, 0);
+            s.goalStamp.resize(n, 0);
+            s.goalCost.resize(n);
+        }
+        std::uint32_t search = ++s.search;
+        for (auto& [node, c] : goalLinks) {
+            s.goalStamp[node] = search;
+            s.goalCost[node] = c;
+        }
+
+        using Entry = std::pair<double, RoadmapId>;
+        std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+        for (auto& [node, c] : startLinks) {
+            if (s.stamp[node] != search || c < s.g[node]) {
+                s.stamp[node] = search;
+                s.g[node] = c;
+                s.parent[node] = kNone;
+                open.emplace(c + distance(nodes[node], goal), node);
+            }
+        }
+
+        RoadmapId last = kNone;
+        double best = std::numeric_limits<double>::infinity();
+        while (!open.empty()) {
+            auto [f, u] = open.top();
+            open.pop();
+            if (f >= best) break;
+            if (f > s.g[u] + distance(nodes[u], goal) + 1e-9) continue;  // stale entry
+            if (s.goalStamp[u] == search && s.g[u] + s.goalCost[u] < best) {
+                best = s.g[u] + s.goalCost[u];
+                last = u;
+            }
+            for (std::int32_t e = firstEdge[u]; e != -1; e = edges[e].next) {
+                RoadmapId v = edges[e].to;
+                double g = s.g[u] + edges[e].cost;
+                if (s.stamp[v] != search || g < s.g[v]) {
+                    s.stamp[v] = search;
+                    s.g[v] = g;
+                    s.parent[v] = u;
+                    open.emplace(g + distance(nodes[v], goal), v);
+                }
+            }
+        }
+        if (last == kNone) return false;
+
+        path.push_back(goal);
+        for (RoadmapId id = last; id != kNone; id = s.parent[id]) {
+            path.push_back(Point<T>(nodes[id]));
+        }
+        path.push_back(start);
+        std::reverse(path.begin(), path.end());
+        cost = best;
+        return true;
+    }
+};
+
+template <typename T>
+struct PlanQuery {
+    std::uint64_t id;
+    Point<T> start, goal;
+};
+
+template <typename T>
+struct PlanResult {
+    std::uint64_t id;
+    bool found = false;
+    double cost = 0;
+    double latencyMs = 0;
+    std::vector<Point<T>> path;
+};
+
+// Long-lived, multi-query planner for one arena.
+// The arena, its dilated collision grid and the roadmap are built once; submitted queries are
+// answered by a worker pool that takes them off a shared queue in batches, each worker reusing
+// its own A* scratch. When queries of a batch fail with both ends free, the roadmap grows once
+// and they are retried, so coverage improves where queries actually need it while later queries
+// stay cheap. Growth stops at maxRoadmapNodes, so unanswerable queries cannot grow it forever.
+// Queries with an end inside an obstacle fail without touching the roadmap.
+template <typename T>
+class PlanningService {
+public:
+    using ResultCallback = std::function<void(const PlanResult<T>&)>;
+    static constexpr std::size_t BatchSize = 16;
+
+private:
+    struct Pending {
+        PlanQuery<T> query;
+        std::chrono::steady_clock::time_point received;
+    };
+
+    CollisionChecker checker;
+    Roadmap<T> roadmap;
+    ResultCallback onResult;
+    std::size_t growthSamples;
+    int maxRetries;
+    std::size_t maxRoadmapNodes;
+
+    std::mutex queueMutex;
+    std::condition_variable queueCv, idleCv;
+    std::deque<Pending> queue;
+    std::size_t inFlight = 0;
+    bool stopping = false;
+    std::vector<std::thread> workers;
+    std::atomic<std::uint64_t> answered{0}, failed{0};
+
+    void finish(const Pending& pending, PlanResult<T>& result) {
+        result.latencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - pending.received).count();
+        (result.found ? answered : failed).fetch_add(1, std::memory_order_relaxed);
+        if (onResult) onResult(result);
+    }
+
+    void work() {
+        typename Roadmap<T>::Scratch scratch;
+        std::vector<Pending> batch;
+        std::vector<std::size_t> retry;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                while (!queue.empty() && batch.size() < BatchSize) {
+                    batch.push_back(queue.front());
+                    queue.pop_front();
+                }
+                inFlight += batch.size();
+            }
+
+            // Answer what the roadmap can; keep the failures whose ends are free for a retry
+            retry.clear();
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                const PlanQuery<T>& query = batch[i].query;
+                PlanResult<T> result;
+                result.id = query.id;
+                result.found = roadmap.query(query.start, query.goal, scratch, result.path, result.cost);
+                if (!result.found && maxRetries > 0 && roadmap.endpointsFree(query.start, query.goal)) {
+                    retry.push_back(i);
+                } else {
+                    finish(batch[i], result);
+                }
+            }
+            // One growth per round for the whole batch, not one per failed query, and only while
+            // the roadmap is below its cap
+            for (int round = 0; round < maxRetries && !retry.empty(); ++round) {
+                bool grown = roadmap.grow(growthSamples, maxRoadmapNodes) > 0;
+                bool last = !grown || round + 1 == maxRetries;
+                std::size_t kept = 0;
+                for (std::size_t i : retry) {
+                    const PlanQuery<T>& query = batch[i].query;
+                    PlanResult<T> result;
+                    result.id = query.id;
+                    result.found = grown && roadmap.query(query.start, query.goal, scratch, result.path, result.cost);
+                    if (result.found || last) {
+                        finish(batch[i], result);
+                    } else {
+                        retry[kept++] = i;
+                    }
+                }
+                retry.resize(kept);
+            }
+
+            std::unique_lock<std::mutex> lock(queueMutex);
+            inFlight -= batch.size();
+            batch.clear();
+            if (queue.empty() && inFlight == 0) idleCv.notify_all();
+        }
+    }
+
+public:
+    // roadmapSamples: initial roadmap size; a batch with failed queries adds growthSamples per
+    // retry, up to maxRoadmapNodes nodes in all
+    PlanningService(Setup<T>& setup, int numWorkers, ResultCallback onResult,
+                    std::size_t roadmapSamples = 4000, std::size_t growthSamples = 1000, int maxRetries = 2,
+                    std::size_t maxRoadmapNodes = 64000)
+        : checker(setup.clearance, setup.dim, setup.footprintRadius()),
+          roadmap(checker, setup.length, setup.width, 2.0 * setup.step_size),
+          onResult(std::move(onResult)), growthSamples(growthSamples), maxRetries(maxRetries), maxRoadmapNodes(maxRoadmapNodes) {
+        auto begin = std::chrono::steady_clock::now();
+        roadmap.grow(roadmapSamples, maxRoadmapNodes);
+        logger->info("Roadmap built: {} nodes, {} edges in {} ms", roadmap.nodeCount(), roadmap.edgeCount(),
+                     std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - begin).count());
+        for (int i = 0; i < std::max(1, numWorkers); ++i) {
+            workers.emplace_back(&PlanningService::work, this);
+        }
+    }
+
+    ~PlanningService() {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            stopping = true;
+        }
+        queueCv.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+        logger->info("Planning service stopped: {} queries answered, {} failed", answered.load(), failed.load());
+    }
+
+    PlanningService(const PlanningService&) = delete;
+    PlanningService& operator=(const PlanningService&) = delete;
+
+    void submit(const PlanQuery<T>& query) {
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queue.push_back({query, std::chrono::steady_clock::now()});
+        }
+        queueCv.notify_one();
+    }
+
+    // Block until every submitted query has been answered
+    void drain() {
+        std::unique_lock<std::mutex> lock(queueMutex);
+        idleCv.wait(lock, [this] { return queue.empty() && inFlight == 0; });
+    }
+
+    const Roadmap<T>& getRoadmap() const { return roadmap; }
+    std::uint64_t answeredCount() const { return answered.load(); }
+    std::uint64_t failedCount() const { return failed.load(); }
+};
@@ -0,0 +1,276 @@
+#pragma once
+#include <vector>
+#include <cmath>
+#include <random>
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+#include "collision_checker.h"
+
+// Sampling state owned by one planner thread.
+// Samples are drawn in batches; accept/reject tallies are kept here and only folded into the
+// sampler's shared counters when a batch is refilled, so threads never contend per sample.
+template <typename PointT>
+struct SampleStream {
+    std::mt19937 gen;
+    std::vector<PointT> batch;
+    std::size_t next = 0;
+    std::uint64_t accepted = 0, rejected = 0;
+    // Position in a low-discrepancy sequence and this thread's random shift of it
+    std::uint64_t sequence = 0;
+    double shiftX = 0, shiftY = 0, shiftZ = 0;
+    bool shifted = false;
+
+    explicit SampleStream(std::seed_seq& seq) : gen(seq) {}
+};
+
+// Source of random points for the planner.
+// PointT needs a (x, y) constructor, and a (x, y, z) one for samplers given a height: those
+// sample the volume length x width x height instead of the floor. A sample is "accepted" if the planner grew the tree
+// with it and "rejected" if it was discarded (blocked, too close, or refused by the sampler
+// itself), so acceptanceRatio() tells how much sampling work turns into tree growth.
+template <typename PointT>
+class Sampler {
+    std::atomic<std::uint64_t> acceptedCount{0}, rejectedCount{0};
+
+protected:
+    double length, width, height;
+
+    double uniform(std::mt19937& gen, double hi) const { return std::uniform_real_distribution<>(0, hi)(gen); }
+
+    // Uniform over the floor, or over the volume when the sampler has a height
+    PointT uniformPoint(std::mt19937& gen) const {
+        double x = uniform(gen, length);
+        double y = uniform(gen, width);
+        if (height > 0) return PointT(x, y, uniform(gen, height));
+        return PointT(x, y);
+    }
+
+public:
+    static constexpr std::size_t BatchSize = 64;
+
+    Sampler(double length, double width, double height = 0) : length(length), width(width), height(height) {}
+    virtual ~Sampler() = default;
+
+    virtual const char* name() const = 0;
+
+    // Append 'n' samples to stream.batch
+    virtual void fill(SampleStream<PointT>& stream, std::size_t n) = 0;
+
+    // Called by the planner whenever a cheaper path to the target is found
+    virtual void pathCostImproved([[maybe_unused]] double cost) {}
+
+    PointT next(SampleStream<PointT>& stream) {
+        if (stream.next == stream.batch.size()) {
+            flush(stream);
+            stream.batch.clear();
+            stream.next = 0;
+            fill(stream, BatchSize);
+        }
+        return stream.batch[stream.next++];
+    }
+
+    void accept(SampleStream<PointT>& stream) { ++stream.accepted; }
+    void reject(SampleStream<PointT>& stream) { ++stream.rejected; }
+
+    // Fold a thread's tallies into the shared counters; the planner calls this when a thread exits
+    void flush(SampleStream<PointT>& stream) {
+        acceptedCount.fetch_add(stream.accepted, std::memory_order_relaxed);
+        rejectedCount.fetch_add(stream.rejected, std::memory_order_relaxed);
+        stream.accepted = stream.rejected = 0;
+    }
+
+    std::uint64_t accepted() const { return acceptedCount.load(); }
+    std::uint64_t rejected() const { return rejectedCount.load(); }
+    double acceptanceRatio() const {
+        std::uint64_t total = accepted() + rejected();
+        return total ? static_cast<double>(accepted()) / total : 0.0;
+    }
+};
+
+// Uniform over the whole arena
+template <typename PointT>
+class UniformSampler : public Sampler<PointT> {
+public:
+    using Sampler<PointT>::Sampler;
+
+    const char* name() const override { return "uniform"; }
+
+    void fill(SampleStream<PointT>& stream, std::size_t n) override {
+        if (this->height > 0) {
+            for (std::size_t i = 0; i < n; ++i) {
+                stream.batch.push_back(this->uniformPoint(stream.gen));
+            }
+            return;
+        }
+        std::uniform_real_distribution<> distX(0, this->length), distY(0, this->width);
+        for (std::size_t i = 0; i < n; ++i) {
+            double x = distX(stream.gen);
+            double y = distY(stream.gen);
+            stream.batch.emplace_back(x, y);
+        }
+    }
+};
+
+// Returns the goal with probability 'bias', otherwise a uniform sample
+template <typename PointT>
+class GoalBiasedSampler : public Sampler<PointT> {
+    PointT goal;
+    double bias;
+
+public:
+    GoalBiasedSampler(double length, double width, const PointT& goal, double bias = 0.05, double height = 0)
+        : Sampler<PointT>(length, width, height), goal(goal), bias(bias) {}
+
+    const char* name() const override { return "goal_biased"; }
+
+    void fill(SampleStream<PointT>& stream, std::size_t n) override {
+        std::uniform_real_distribution<> coin(0, 1);
+        for (std::size_t i = 0; i < n; ++i) {
+            if (coin(stream.gen) < bias) {
+                stream.batch.push_back(goal);
+            } else {
+                stream.batch.push_back(this->uniformPoint(stream.gen));
+            }
+        }
+    }
+};
+
+// Uniform, but draws where the robot's footprint does not fit are rejected and redrawn
+template <typename PointT>
+class FreeSpaceSampler : public Sampler<PointT> {
+    const CollisionChecker& checker;
+
+public:
+    FreeSpaceSampler(double length, double width, const CollisionChecker& checker)
+        : Sampler<PointT>(length, width), checker(checker) {}
+
+    const char* name() const override { return "free_space"; }
+
+    void fill(SampleStream<PointT>& stream, std::size_t n) override {
+        std::uniform_real_distribution<> distX(0, this->length), distY(0, this->width);
+        for (std::size_t i = 0; i < n;) {
+            double x = distX(stream.gen);
+            double y = distY(stream.gen);
+            if (checker.pointFree(x, y)) {
+                stream.batch.emplace_back(x, y);
+                ++i;
+            } else {
+                this->reject(stream);
+            }
+        }
+    }
+};
+
+// Informed sampling: once a path of cost c is known, only points inside the ellipse with foci
+// start and goal and major axis c can improve it. Until then it samples the whole arena.
+template <typename PointT>
+class InformedSampler : public Sampler<PointT> {
+    double startX, startY, goalX, goalY;
+    std::atomic<double> bestCost{std::numeric_limits<double>::infinity()};
+
+public:
+    InformedSampler(double length, double width, const PointT& start, const PointT& goal)
+        : Sampler<PointT>(length, width),
+          startX(start.getX()), startY(start.getY()), goalX(goal.getX()), goalY(goal.getY()) {}
+
+    const char* name() const override { return "informed"; }
+
+    void pathCostImproved(double cost) override { bestCost.store(cost, std::memory_order_relaxed); }
+
+    void fill(SampleStream<PointT>& stream, std::size_t n) override {
+        double cMax = bestCost.load(std::memory_order_relaxed);
+        if (cMax == std::numeric_limits<double>::infinity()) {
+            for (std::size_t i = 0; i < n; ++i) {
+                double x = this->uniform(stream.gen, this->length);
+                double y = this->uniform(stream.gen, this->width);
+                stream.batch.emplace_back(x, y);
+            }
+            return;
+        }
+
+        double dx = goalX - startX, dy = goalY - startY;
+        double cMin = std::sqrt(dx * dx + dy * dy);
+        double centreX = (startX + goalX) / 2, centreY = (startY + goalY) / 2;
+        double cosA = cMin > 0 ? dx / cMin : 1.0, sinA = cMin > 0 ? dy / cMin : 0.0;
+        double r1 = cMax / 2, r2 = std::sqrt(std::max(0.0, cMax * cMax - cMin * cMin)) / 2;
+        std::uniform_real_distribution<> unit(0, 1), angle(0, 2 * M_PI);
+
+        for (std::size_t i = 0; i < n;) {
+            // Uniform point in the unit disc, stretched onto the ellipse and rotated onto start->goal
+            double r = std::sqrt(unit(stream.gen)), a = angle(stream.gen);
+            double ex = r1 * r * std::cos(a), ey = r2 * r * std::sin(a);
+            double x = centreX + cosA * ex - sinA * ey;
+            double y = centreY + sinA * ex + cosA * ey;
+            if (x >= 0 && x <= this->length && y >= 0 && y <= this->width) {
+                stream.batch.emplace_back(x, y);
+                ++i;
+            } else {
+                this->reject(stream);
+            }
+        }
+    }
+};
+
+// Low-discrepancy samples from the 2D Halton (bases 2 and 3) or Sobol sequence.
+// With a height, z comes from the base-5 radical inverse (the third Halton dimension) for
+// either sequence. Every thread walks the same sequence with its own random toroidal shift
+// (Cranley-Patterson rotation), so streams stay well spread without coordinating threads.
+template <typename PointT>
+class LowDiscrepancySampler : public Sampler<PointT> {
+public:
+    enum class Sequence { Halton, Sobol };
+
+private:
+    Sequence sequence;
+
+    static double radicalInverse(std::uint64_t i, unsigned base) {
+        double inv = 1.0 / base, f = inv, r = 0;
+        for (; i > 0; i /= base, f *= inv) {
+            r += f * (i % base);
+        }
+        return r;
+    }
+
+    // Second Sobol dimension (primitive polynomial x + 1); the first is the base-2 radical inverse
+    static double sobol2(std::uint64_t i) {
+        std::uint32_t v = std::uint32_t(1) << 31, r = 0;
+        for (; i > 0; i >>= 1, v ^= v >> 1) {
+            if (i & 1) r ^= v;
+        }
+        return r * (1.0 / 4294967296.0);
+    }
+
+public:
+    LowDiscrepancySampler(double length, double width, Sequence sequence = Sequence::Halton, double height = 0)
+        : Sampler<PointT>(length, width, height), sequence(sequence) {}
+
+    const char* name() const override { return sequence == Sequence::Halton ? "halton" : "sobol"; }
+
+    void fill(SampleStream<PointT>& stream, std::size_t n) override {
+        if (!stream.shifted) {
+            stream.shiftX = this->uniform(stream.gen, 1.0);
+            stream.shiftY = this->uniform(stream.gen, 1.0);
+            stream.shiftZ = this->uniform(stream.gen, 1.0);
+            stream.shifted = true;
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            std::uint64_t k = ++stream.sequence;
+            double u = radicalInverse(k, 2);
+            double v = sequence == Sequence::Halton ? radicalInverse(k, 3) : sobol2(k);
+            u += stream.shiftX;
+            v += stream.shiftY;
+            u -= std::floor(u);
+            v -= std::floor(v);
+            if (this->height > 0) {
+                double w = radicalInverse(k, 5) + stream.shiftZ;
+                w -= std::floor(w);
+                stream.batch.emplace_back(u * this->length, v * this->width, w * this->height);
+            } else {
+                stream.batch.emplace_back(u * this->length, v * this->width);
+            }
+        }
+    }
+};
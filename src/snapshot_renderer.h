@@ -0,0 +1,241 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <SFML/Graphics.hpp>
+#include "tree_snapshot.h"
+
+struct RenderOptions {
+    int maxSide = 2048;       // pixels along the longer side; never more than one pixel per world unit
+    bool drawNodes = true;
+    int pathWidth = 5;        // pixels
+};
+
+// Opaque pixel packed as RGBA in memory order (native little-endian, like the snapshot)
+constexpr std::uint32_t rgbaPixel(std::uint32_t r, std::uint32_t g, std::uint32_t b) { return r | g << 8 | b << 16 | 0xFF000000u; }
+
+// Headless renderer for TreeSnapshot. It rasterizes on the CPU into an RGBA buffer, so it needs
+// neither a window nor an OpenGL context (an offscreen sf::RenderTexture still needs a display
+// on Linux); SFML only encodes the image. Every layer is built once as one flat vertex buffer
+// in pixel coordinates: tree edges and node points in node id order, then the path. The static
+// obstacle layer is rasterized once from the snapshot's tiles, downsampled to the image, and
+// every render starts from a copy of it. Growth animations draw each frame's new edges on top
+// of the previous frame, so a whole sequence costs one pass over the edges.
+class SnapshotRenderer {
+    static constexpr std::uint32_t Background = rgbaPixel(255, 255, 255);
+    static constexpr std::uint32_t ObstacleColor = rgbaPixel(101, 67, 33);   // dark brown
+    static constexpr std::uint32_t NodeColor = rgbaPixel(0, 128, 128);       // dark teal
+    static constexpr std::uint32_t EdgeColor = rgbaPixel(0, 102, 102);       // slightly lighter teal
+    static constexpr std::uint32_t EndpointColor = rgbaPixel(50, 50, 50);    // dark gray
+    static constexpr std::uint32_t PathColor = rgbaPixel(0, 0, 0);
+
+    const TreeSnapshot& snapshot;
+    RenderOptions options;
+    int imageWidth = 1, imageHeight = 1;
+    double scale = 1;    // pixels per world unit
+    std::vector<std::uint32_t> obstacleLayer, frame;
+    std::vector<float> edges;            // x0, y0, x1, y1 per edge
+    std::vector<std::uint32_t> edgeNode; // child node of each edge, ascending
+    std::vector<float> path;             // x, y per waypoint
+
+    void plot(int x, int y, std::uint32_t color) {
+        if (x >= 0 && x < imageWidth && y >= 0 && y < imageHeight) frame[static_cast<std::size_t>(y) * imageWidth + x] = color;
+    }
+
+    void fillRect(std::vector<std::uint32_t>& layer, int x0, int y0, int x1, int y1, std::uint32_t color) {
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        x1 = std::min(x1, imageWidth - 1);
+        y1 = std::min(y1, imageHeight - 1);
+        for (int y = y0; y <= y1; ++y) {
+            std::fill(&layer[static_cast<std::size_t>(y) * imageWidth + x0], &layer[static_cast<std::size_t>(y) * imageWidth + x1] + 1, color);
+        }
+    }
+
+    // Bresenham line; width > 1 stamps a square of that side at every step
+    void line(float fx0, float fy0, float fx1, float fy1, std::uint32_t color, int width = 1) {
+        int x0 = static_cast<int>(fx0), y0 = static_cast<int>(fy0), x1 = static_cast<int>(fx1), y1 = static_cast<int>(fy1);
+        int dx = std::abs(x1 - x0), dy = -std::abs(y1 - y0), sx = x0 < x1 ? 1 : -1, sy = y0 < y1 ? 1 : -1;
+        int half = width / 2;
+        for (int err = dx + dy;;) {
+            if (width > 1) {
+                fillRect(frame, x0 - half, y0 - half, x0 - half + width - 1, y0 - half + width - 1, color);
+            } else {
+                plot(x0, y0, color);
+            }
+            if (x0 == x1 && y0 == y1) break;
+            int e2 = 2 * err;
+            if (e2 >= dy) { err += dy; x0 += sx; }
+            if (e2 <= dx) { err += dx; y0 += sy; }
+        }
+    }
+
+    void disc(float cx, float cy, float radius, std::uint32_t color) {
+        int r = std::max(1, static_cast<int>(radius));
+        for (int dy = -r; dy <= r; ++dy) {
+            for (int dx = -r; dx <= r; ++dx) {
+                if (dx * dx + dy * dy <= r * r) plot(static_cast<int>(cx) + dx, static_cast<int>(cy) + dy, color);
+            }
+        }
+    }
+
+    // Pixel span [p0, p1] covered by cells c0..c1 along one axis
+    void cellSpan(int c0, int c1, int& p0, int& p1) const {
+        double pixelsPerCell = snapshot.cellSize * scale;
+        p0 = static_cast<int>(c0 * pixelsPerCell);
+        p1 = std::max(p0, static_cast<int>(std::ceil((c1 + 1) * pixelsPerCell)) - 1);
+    }
+
+    void buildObstacleLayer() {
+        using namespace tiled_map;
+        obstacleLayer.assign(static_cast<std::size_t>(imageWidth) * imageHeight, Background);
+        std::size_t tilesX = snapshot.tilesX(), tilesY = tilesAlong(snapshot.rows);
+        int px0, px1, py0, py1;
+        for (std::size_t ty = 0; ty < tilesY; ++ty) {
+            for (std::size_t tx = 0; tx < tilesX; ++tx) {
+                const std::uint64_t* words = snapshot.tileWords(ty * tilesX + tx);
+                if (!words) continue;
+                int cx0 = static_cast<int>(tx << TileBits), cy0 = static_cast<int>(ty << TileBits);
+                if (words == FullTileWords.words) {
+                    cellSpan(cx0, cx0 + TileSize - 1, px0, px1);
+                    cellSpan(cy0, cy0 + TileSize - 1, py0, py1);
+                    fillRect(obstacleLayer, px0, py0, px1, py1, ObstacleColor);
+                    continue;
+                }
+                for (int r = 0; r < TileSize; ++r) {
+                    cellSpan(cy0 + r, cy0 + r, py0, py1);
+                    for (std::uint64_t bits = words[r]; bits; bits &= bits - 1) {
+                        int cx = cx0 + __builtin_ctzll(bits);
+                        cellSpan(cx, cx, px0, px1);
+                        fillRect(obstacleLayer, px0, py0, px1, py1, ObstacleColor);
+                    }
+                }
+            }
+        }
+    }
+
+    // Edges and points of nodes [from, to)
+    void drawNodes(std::size_t from, std::size_t to) {
+        auto first = std::lower_bound(edgeNode.begin(), edgeNode.end(), from) - edgeNode.begin();
+        auto last = std::lower_bound(edgeNode.begin(), edgeNode.end(), to) - edgeNode.begin();
+        for (auto e = first; e < last; ++e) {
+            const float* v = &edges[4 * e];
+            line(v[0], v[1], v[2], v[3], EdgeColor);
+        }
+        if (!options.drawNodes) return;
+        for (std::size_t id = from; id < to; ++id) {
+            plot(static_cast<int>(snapshot.x[id] * scale), static_cast<int>(snapshot.y[id] * scale), NodeColor);
+        }
+    }
+
+    void drawOverlay(bool withPath) {
+        if (withPath) {
+            for (std::size_t i = 2; i < path.size(); i += 2) {
+                line(path[i - 2], path[i - 1], path[i], path[i + 1], PathColor, options.pathWidth);
+            }
+        }
+        float radius = static_cast<float>(std::max(3.0, snapshot.cellSize * scale / 2));
+        disc(static_cast<float>(snapshot.start[0] * scale), static_cast<float>(snapshot.start[1] * scale), radius, EndpointColor);
+        disc(static_cast<float>(snapshot.target[0] * scale), static_cast<float>(snapshot.target[1] * scale), radius, EndpointColor);
+    }
+
+public:
+    explicit SnapshotRenderer(const TreeSnapshot& snapshot, RenderOptions options = RenderOptions())
+        : snapshot(snapshot), options(options) {
+        double worldWidth = snapshot.cols * snapshot.cellSize, worldHeight = snapshot.rows * snapshot.cellSize;
+        scale = std::min(1.0, options.maxSide / std::max({worldWidth, worldHeight, 1.0}));
+        imageWidth = std::max(1, static_cast<int>(std::ceil(worldWidth * scale)));
+        imageHeight = std::max(1, static_cast<int>(std::ceil(worldHeight * scale)));
+        buildObstacleLayer();
+
+        for (std::size_t id = 0; id < snapshot.nodeCount(); ++id) {
+            std::uint32_t parent = snapshot.parent[id];
+            if (parent == kNoNode) continue;
+            // Goal-tree parents are ids within the goal tree
+            std::size_t p = id >= snapshot.goalTreeBegin ? snapshot.goalTreeBegin + parent : parent;
+            edges.insert(edges.end(), {static_cast<float>(snapshot.x[p] * scale), static_cast<float>(snapshot.y[p] * scale),
+                                       static_cast<float>(snapshot.x[id] * scale), static_cast<float>(snapshot.y[id] * scale)});
+            edgeNode.push_back(static_cast<std::uint32_t>(id));
+        }
+        for (std::size_t i = 0; i < snapshot.pathX.size(); ++i) {
+            path.push_back(static_cast<float>(snapshot.pathX[i] * scale));
+            path.push_back(static_cast<float>(snapshot.pathY[i] * scale));
+        }
+    }
+
+    int width() const { return imageWidth; }
+    int height() const { return imageHeight; }
+
+    // Render the first 'nodes' nodes (all by default) over the obstacle layer; the path is drawn
+    // with the whole tree. Returns width() x height() RGBA pixels.
+    const std::uint8_t* render(std::size_t nodes = static_cast<std::size_t>(-1)) {
+        nodes = std::min(nodes, snapshot.nodeCount());
+        frame = obstacleLayer;
+        drawNodes(0, nodes);
+        drawOverlay(nodes == snapshot.nodeCount());
+        return reinterpret_cast<const std::uint8_t*>(frame.data());
+    }
+
+    // Write the current frame; the format follows the extension (.png, .bmp, .tga, .jpg)
+    bool save(const std::string& file) const {
+        sf::Image image;
+        image.create(imageWidth, imageHeight, reinterpret_cast<const sf::Uint8*>(frame.data()));
+        if (!image.saveToFile(file)) {
+            logger->error("Could not write image {}", file);
+            return false;
+        }
+        return true;
+    }
+
+    bool writeImage(const std::string& file) {
+        render();
+        return save(file);
+    }
+
+    // Growth animation: 'frames' images prefix_00000.png ... adding nodes in insertion order, the
+    // last one with the path (e.g. ffmpeg -i prefix_%05d.png tree.mp4); returns frames written
+    int writeFrames(const std::string& prefix, int frames) {
+        frames = std::max(1, frames);
+        std::size_t total = snapshot.nodeCount(), drawn = 0;
+        frame = obstacleLayer;
+        for (int k = 1; k <= frames; ++k) {
+            std::size_t nodes = total * k / frames;
+            drawNodes(drawn, nodes);
+            drawn = nodes;
+            drawOverlay(k == frames);
+            if (!save(fmt::format("{}_{:05d}.png", prefix, k - 1))) return k - 1;
+        }
+        return frames;
+    }
+};
+
+// Show the arena, the tree and the path in a window. The picture is rendered once by
+// SnapshotRenderer into a texture; every frame only draws that texture.
+template <typename T>
+void visualize(const Setup<T>& setup, const TreeStore<T>& tree, const std::vector<Point<T>>& path) {
+    TreeSnapshot snapshot = captureSnapshot(setup, tree, path);
+    RenderOptions options;
+    options.maxSide = std::max(setup.length, setup.width);
+    SnapshotRenderer renderer(snapshot, options);
+    const std::uint8_t* pixels = renderer.render();
+
+    sf::RenderWindow window(sf::VideoMode(renderer.width(), renderer.height()), "RRT Tree and Path Visualization");
+    sf::Texture texture;
+    texture.create(renderer.width(), renderer.height());
+    texture.update(pixels);
+    sf::Sprite sprite(texture);
+
+    while (window.isOpen()) {
+        sf::Event event;
+        while (window.pollEvent(event)) {
+            if (event.type == sf::Event::Closed)
+                window.close();
+        }
+        window.clear(sf::Color::White);
+        window.draw(sprite);
+        window.display();
+    }
+}
@@ -1,4 +1,550 @@
-int main()
-{
-    return 0;
-}
\ No newline at end of file
+#include "arena_definitions.cpp"
+#include "tree_snapshot.h"
+#include "planner_portfolio.h"
+#include "planning_service.h"
+#include "path_smoother.h"
+#include <gtest/gtest.h>
+#include <spdlog/sinks/null_sink.h>
+
+// Planner code is checked against brute-force references: every cell, every permutation or
+// every sample along a segment, on arenas small enough for that to be cheap.
+
+namespace {
+
+// Planner code logs through the global logger; discard everything while testing
+class QuietLogger : public ::testing::Environment {
+public:
+    void SetUp() override { logger = spdlog::null_logger_mt("test_logger"); }
+};
+const ::testing::Environment* const quietLogger = ::testing::AddGlobalTestEnvironment(new QuietLogger);
+
+// The 1000 x 1000 warehouse rrt_3d plans in by default
+std::unique_ptr<Setup<int>> makeWarehouse() {
+    auto setup = std::make_unique<Setup<int>>(10, 10, 1000, 1000, Point<int>(10, 10), Point<int>(950, 950), 50);
+    addWarehouseObstacles(*setup, 1000, 1000);
+    return setup;
+}
+
+// Random axis-aligned blocks from a fixed seed, clear of the corners where plans start and end
+std::unique_ptr<Setup<int>> makeClutter(int size, int blocks, unsigned seed) {
+    auto setup = std::make_unique<Setup<int>>(10, 10, size, size, Point<int>(10, 10), Point<int>(size - 50, size - 50), 50);
+    std::mt19937 gen(seed);
+    std::uniform_int_distribution<int> pos(0, size - 1), side(size / 50, size / 15);
+    for (int b = 0; b < blocks; ++b) {
+        int x = pos(gen), y = pos(gen), w = side(gen), h = side(gen);
+        if ((x < 150 && y < 150) || (x + w > size - 150 && y + h > size - 150)) continue;
+        int x1 = std::min(x + w, size - 1), y1 = std::min(y + h, size - 1);
+        setup->addObstacle({Point<int>(x, y), Point<int>(x1, y), Point<int>(x1, y1), Point<int>(x, y1)});
+    }
+    return setup;
+}
+
+std::string tempPath(const std::string& name) { return ::testing::TempDir() + name; }
+
+// Gap in cells between two unit-square cells, as ClearanceMap defines it
+double cellGap(int x, int y, int ox, int oy) {
+    double dx = std::max(0, std::abs(x - ox) - 1), dy = std::max(0, std::abs(y - oy) - 1);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+// Does the segment (in cell units) pass through the interior of cell (cx, cy)? Liang-Barsky
+// clipping against the cell's square.
+bool segmentCrossesCell(double x0, double y0, double x1, double y1, int cx, int cy) {
+    double t0 = 0, t1 = 1;
+    double p[4] = {-(x1 - x0), x1 - x0, -(y1 - y0), y1 - y0};
+    double q[4] = {x0 - cx, cx + 1 - x0, y0 - cy, cy + 1 - y0};
+    for (int i = 0; i < 4; ++i) {
+        if (p[i] == 0) {
+            if (q[i] <= 0) return false;
+        } else if (p[i] < 0) {
+            t0 = std::max(t0, q[i] / p[i]);
+        } else {
+            t1 = std::min(t1, q[i] / p[i]);
+        }
+    }
+    return t0 < t1;
+}
+
+// Checks the parent/child links and path costs of every node still hanging from the root and
+// returns how many there are. Detached nodes (no parent, not the root) are skipped.
+template <typename T>
+std::size_t expectConsistentTree(const TreeStore<T>& tree) {
+    EXPECT_EQ(tree.parent(0), kNoNode);
+    EXPECT_EQ(tree.cost(0), 0.0);
+    std::vector<bool> reached(tree.size());
+    std::vector<NodeId> pending{0};
+    reached[0] = true;
+    std::size_t attached = 0;
+    while (!pending.empty()) {
+        NodeId id = pending.back();
+        pending.pop_back();
+        ++attached;
+        tree.forEachChild(id, [&](NodeId child) {
+            EXPECT_EQ(tree.parent(child), id);
+            EXPECT_FALSE(reached[child]) << "node " << child << " is listed twice";
+            reached[child] = true;
+            Point<T> a = tree.point(id), b = tree.point(child);
+            double edge = std::hypot(static_cast<double>(b.getX() - a.getX()), static_cast<double>(b.getY() - a.getY()));
+            EXPECT_NEAR(tree.cost(child), tree.cost(id) + edge, 1e-6 * (1 + tree.cost(child))) << "node " << child;
+            pending.push_back(child);
+        });
+    }
+    // Every node with a parent is in its parent's child list, so it was reached from the root
+    for (NodeId id = 1; id < tree.size(); ++id) {
+        if (tree.parent(id) != kNoNode) {
+            EXPECT_TRUE(reached[id]) << "node " << id << " is not in its parent's child list";
+        }
+    }
+    return attached;
+}
+
+// Every edge of the tree is collision-free for the robot
+template <typename T>
+void expectFreeEdges(const TreeStore<T>& tree, const CollisionChecker& checker) {
+    for (NodeId id = 1; id < tree.size(); ++id) {
+        NodeId parent = tree.parent(id);
+        if (parent == kNoNode) continue;
+        Point<T> a = tree.point(parent), b = tree.point(id);
+        EXPECT_TRUE(checker.segmentFree(a.getX(), a.getY(), b.getX(), b.getY())) << "edge into node " << id;
+    }
+}
+
+}  // namespace
+
+TEST(ClearanceMap, MatchesBruteForceDistances) {
+    // Larger than one 256-cell chunk, so values are checked across chunk borders
+    OccupancyGrid grid(300, 280);
+    std::mt19937 gen(3);
+    std::uniform_int_distribution<int> col(0, grid.cols() - 1), row(0, grid.rows() - 1);
+    std::vector<std::pair<int, int>> obstacles;
+    auto addObstacle = [&](int x, int y) {
+        grid.setObstacle(x, y, true);
+        obstacles.emplace_back(x, y);
+    };
+    for (int i = 0; i < 120; ++i) addObstacle(col(gen), row(gen));
+    ClearanceMap clearance(grid);
+
+    auto expectBruteForce = [&] {
+        for (int y = 0; y < grid.rows(); ++y) {
+            for (int x = 0; x < grid.cols(); ++x) {
+                double expected = ClearanceMap::MaxClearance;
+                for (auto [ox, oy] : obstacles) expected = std::min(expected, cellGap(x, y, ox, oy));
+                ASSERT_NEAR(clearance.clearance(x, y), expected, 1e-4) << "cell " << x << ", " << y;
+            }
+        }
+    };
+    expectBruteForce();
+
+    // Incremental update after more obstacles, once every chunk has been computed
+    for (int i = 0; i < 40; ++i) {
+        int x = col(gen), y = row(gen);
+        addObstacle(x, y);
+        clearance.markChanged(x, y);
+    }
+    clearance.update();
+    expectBruteForce();
+}
+
+TEST(CollisionChecker, SegmentFreeMatchesDenseSampling) {
+    auto setup = makeClutter(3000, 120, 5);
+    CollisionChecker checker(setup->clearance, setup->dim, setup->footprintRadius());
+    const OccupancyGrid& grid = setup->arena;
+    double radius = checker.footprintRadiusCells();
+    auto blocked = [&](int cx, int cy) { return !grid.inBounds(cx, cy) || setup->clearance.clearance(cx, cy) < radius; };
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<double> coord(-20, 3020), offset(-400, 400);
+    int freeSegments = 0, blockedSegments = 0;
+    for (int i = 0; i < 1500; ++i) {
+        // Mostly short edges like the planner's, some long ones that skip ahead over open floor
+        double x0 = coord(gen), y0 = coord(gen);
+        double span = i % 4 == 0 ? 8 : 1;
+        double x1 = x0 + offset(gen) * span, y1 = y0 + offset(gen) * span;
+        bool result = checker.segmentFree(x0, y0, x1, y1);
+
+        // Exact reference: every cell of the bounding box the segment passes through, except the
+        // start cell; a segment starting outside the arena is never free
+        double fx0 = x0 / setup->dim, fy0 = y0 / setup->dim, fx1 = x1 / setup->dim, fy1 = y1 / setup->dim;
+        int sx = static_cast<int>(std::floor(fx0)), sy = static_cast<int>(std::floor(fy0));
+        bool expected = grid.inBounds(sx, sy);
+        for (int cy = static_cast<int>(std::floor(std::min(fy0, fy1))); expected && cy <= std::floor(std::max(fy0, fy1)); ++cy) {
+            for (int cx = static_cast<int>(std::floor(std::min(fx0, fx1))); expected && cx <= std::floor(std::max(fx0, fx1)); ++cx) {
+                if ((cx != sx || cy != sy) && blocked(cx, cy) && segmentCrossesCell(fx0, fy0, fx1, fy1, cx, cy)) expected = false;
+            }
+        }
+        ASSERT_EQ(result, expected) << "segment (" << x0 << ", " << y0 << ") -> (" << x1 << ", " << y1 << ")";
+
+        // Dense samples, 100 per cell: any blocked cell they land in outside the start cell must
+        // make the segment blocked
+        double length = std::hypot(fx1 - fx0, fy1 - fy0);
+        int samples = static_cast<int>(length * 100) + 1;
+        bool sampledBlocked = !grid.inBounds(sx, sy);
+        for (int s = 0; s <= samples && !sampledBlocked; ++s) {
+            double t = static_cast<double>(s) / samples;
+            int cx = static_cast<int>(std::floor(fx0 + t * (fx1 - fx0))), cy = static_cast<int>(std::floor(fy0 + t * (fy1 - fy0)));
+            sampledBlocked = (cx != sx || cy != sy) && blocked(cx, cy);
+        }
+        if (sampledBlocked) {
+            ASSERT_FALSE(result) << "segment (" << x0 << ", " << y0 << ") -> (" << x1 << ", " << y1 << ")";
+        }
+        (result ? freeSegments : blockedSegments)++;
+    }
+    // Both outcomes were exercised
+    EXPECT_GT(freeSegments, 100);
+    EXPECT_GT(blockedSegments, 100);
+}
+
+TEST(TiledMap, RoundTripsEveryCell) {
+    // Edges that do not fill their tiles, an empty tile, a full tile and mixed ones
+    const int cols = 200, rows = 150;
+    std::mt19937 gen(2);
+    std::vector<std::uint8_t> cells(static_cast<std::size_t>(cols) * rows);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            bool full = x >= 64 && x < 128 && y < 64;
+            bool empty = x < 64 && y < 64;
+            cells[static_cast<std::size_t>(y) * cols + x] = full || (!empty && gen() % 5 == 0);
+        }
+    }
+    std::string path = tempPath("round_trip.rrtmap");
+    TiledMapWriter writer(path, cols, rows, 0.25);
+    for (int y = 0; y < rows; ++y) writer.addRow(&cells[static_cast<std::size_t>(y) * cols]);
+    ASSERT_TRUE(writer.finish());
+
+    std::string error;
+    std::unique_ptr<TiledMapFile> map = TiledMapFile::open(path, error);
+    ASSERT_TRUE(map) << error;
+    EXPECT_EQ(map->entry(0), tiled_map::EmptyTile);
+    EXPECT_EQ(map->entry(1), tiled_map::FullTile);
+    OccupancyGrid grid(std::move(map));
+    ASSERT_EQ(grid.cols(), cols);
+    ASSERT_EQ(grid.rows(), rows);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            ASSERT_EQ(grid.isObstacle(x, y), cells[static_cast<std::size_t>(y) * cols + x] != 0) << "cell " << x << ", " << y;
+        }
+    }
+}
+
+TEST(TiledMap, RejectsHeadersThatOverflowTheFileBounds) {
+    std::string path = tempPath("valid.rrtmap");
+    {
+        TiledMapWriter writer(path, 100, 100, 1.0);
+        std::vector<std::uint8_t> row(100, 1);
+        for (int y = 0; y < 100; ++y) writer.addRow(row.data());
+        ASSERT_TRUE(writer.finish());
+    }
+    auto corrupt = [&](std::size_t offset, std::uint64_t value) {
+        std::string copy = tempPath("corrupt.rrtmap");
+        {
+            std::ifstream in(path, std::ios::binary);
+            std::ofstream out(copy, std::ios::binary | std::ios::trunc);
+            out << in.rdbuf();
+        }
+        std::fstream file(copy, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(static_cast<std::streamoff>(offset));
+        file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+        file.close();
+        std::string error;
+        return TiledMapFile::open(copy, error);
+    };
+    std::size_t dataTiles = offsetof(tiled_map::Header, dataTiles), dataOffset = offsetof(tiled_map::Header, dataOffset);
+    EXPECT_FALSE(corrupt(dataTiles, ~std::uint64_t(0) / tiled_map::TileBytes + 1));
+    EXPECT_FALSE(corrupt(dataOffset, ~std::uint64_t(0) - tiled_map::PageSize + 1));
+    EXPECT_FALSE(corrupt(dataOffset, 0));
+}
+
+TEST(Setup, SaveMapLoadsBackCellByCell) {
+    auto setup = makeClutter(2000, 60, 9);
+    // A filled stretch that covers whole tiles
+    setup->addObstacle({Point<int>(700, 700), Point<int>(1500, 700), Point<int>(1500, 1500), Point<int>(700, 1500)});
+    std::string path = tempPath("arena.rrtmap");
+    ASSERT_TRUE(setup->saveMap(path));
+
+    std::string error;
+    std::unique_ptr<TiledMapFile> map = TiledMapFile::open(path, error);
+    ASSERT_TRUE(map) << error;
+    ::Setup<int> loaded(10, 10, std::move(map), setup->start, setup->target, 50);
+    ASSERT_EQ(loaded.arena.cols(), setup->arena.cols());
+    ASSERT_EQ(loaded.arena.rows(), setup->arena.rows());
+    EXPECT_EQ(loaded.dim, setup->dim);
+    std::size_t obstacles = 0;
+    for (int y = 0; y < setup->arena.rows(); ++y) {
+        for (int x = 0; x < setup->arena.cols(); ++x) {
+            ASSERT_EQ(loaded.arena.isObstacle(x, y), setup->arena.isObstacle(x, y)) << "cell " << x << ", " << y;
+            obstacles += setup->arena.isObstacle(x, y);
+        }
+    }
+    EXPECT_GT(obstacles, 0u);
+}
+
+TEST(TreeSnapshot, LoadsBackWhatWasSaved) {
+    auto setup = makeWarehouse();
+    RRTPlanner<int> rrt(*setup, 3);
+    rrt.setMode(PlannerMode::Connect);
+    PlanOptions options;
+    options.nodeBudget = 20000;
+    PlanOutcome<Point<int>> outcome = rrt.plan(options);
+    ASSERT_EQ(outcome.status, PlanStatus::Found);
+
+    TreeSnapshot snapshot = captureSnapshot(*setup, rrt.getTree(), outcome.path, &rrt.getGoalTree());
+    std::string path = tempPath("run.rrtsnap"), error;
+    ASSERT_TRUE(snapshot.save(path, error)) << error;
+    std::unique_ptr<TreeSnapshot> loaded = TreeSnapshot::load(path, error);
+    ASSERT_TRUE(loaded) << error;
+
+    EXPECT_EQ(loaded->cols, setup->arena.cols());
+    EXPECT_EQ(loaded->rows, setup->arena.rows());
+    EXPECT_EQ(loaded->cellSize, setup->dim);
+    EXPECT_EQ(loaded->goalTreeBegin, rrt.getTree().size());
+    ASSERT_EQ(loaded->nodeCount(), rrt.getTree().size() + rrt.getGoalTree().size());
+    for (NodeId id = 0; id < loaded->nodeCount(); ++id) {
+        bool inGoalTree = id >= loaded->goalTreeBegin;
+        const TreeStore<int>& tree = inGoalTree ? rrt.getGoalTree() : rrt.getTree();
+        NodeId node = inGoalTree ? id - loaded->goalTreeBegin : id;
+        ASSERT_EQ(loaded->x[id], static_cast<float>(tree.x(node)));
+        ASSERT_EQ(loaded->y[id], static_cast<float>(tree.y(node)));
+        ASSERT_EQ(loaded->parent[id], tree.parent(node));
+    }
+    ASSERT_EQ(loaded->pathX.size(), outcome.path.size());
+    for (std::size_t i = 0; i < outcome.path.size(); ++i) {
+        EXPECT_EQ(loaded->pathX[i], static_cast<float>(outcome.path[i].getX()));
+        EXPECT_EQ(loaded->pathY[i], static_cast<float>(outcome.path[i].getY()));
+    }
+    for (int y = 0; y < loaded->rows; ++y) {
+        for (int x = 0; x < loaded->cols; ++x) {
+            ASSERT_EQ(loaded->isObstacle(x, y), setup->arena.isObstacle(x, y)) << "cell " << x << ", " << y;
+        }
+    }
+}
+
+TEST(StarPlan, RewiredCostsAreTheSumOfTheEdgeLengths) {
+    auto setup = makeWarehouse();
+    RRTPlanner<int> rrt(*setup, 5);
+    rrt.setMode(PlannerMode::Star);
+    PlanOptions options;
+    options.nodeBudget = 6000;
+    PlanOutcome<Point<int>> outcome = rrt.plan(options);
+    ASSERT_EQ(outcome.status, PlanStatus::Found);
+    EXPECT_GT(outcome.stats.rewired, 0u);
+    EXPECT_EQ(expectConsistentTree(rrt.getTree()), static_cast<std::size_t>(rrt.nodeCount()));
+    expectFreeEdges(rrt.getTree(), rrt.getCollisionChecker());
+
+    double length = 0;
+    for (std::size_t i = 1; i < outcome.path.size(); ++i) {
+        length += std::hypot(static_cast<double>(outcome.path[i].getX() - outcome.path[i - 1].getX()),
+                             static_cast<double>(outcome.path[i].getY() - outcome.path[i - 1].getY()));
+    }
+    EXPECT_NEAR(outcome.cost, length, 1e-6 * length);
+}
+
+TEST(StarPlan, SecondPlanKeepsImprovingThePath) {
+    auto setup = makeWarehouse();
+    RRTPlanner<int> rrt(*setup, 7);
+    rrt.setMode(PlannerMode::Star);
+    PlanOptions options;
+    options.nodeBudget = 4000;
+    PlanOutcome<Point<int>> first = rrt.plan(options);
+    ASSERT_EQ(first.status, PlanStatus::Found);
+    EXPECT_GE(first.nodes, options.nodeBudget);
+
+    // The node budget counts the nodes kept from the first call
+    options.nodeBudget = first.nodes + 8000;
+    PlanOutcome<Point<int>> second = rrt.plan(options);
+    ASSERT_EQ(second.status, PlanStatus::Found);
+    EXPECT_GE(second.nodes, options.nodeBudget);
+    EXPECT_LT(second.cost, first.cost);
+}
+
+TEST(TreeStore, PruneKeepsLinksAndCostsConsistent) {
+    for (PlannerMode mode : {PlannerMode::RRT, PlannerMode::Star}) {
+        auto setup = makeWarehouse();
+        RRTPlanner<int> rrt(*setup, 2);
+        rrt.setMode(mode);
+        PlanOptions options;
+        options.maxTreeNodes = 1500;
+        // RRT stops at the first path; Star keeps growing and pruning until the budget
+        options.timeBudget = std::chrono::milliseconds(mode == PlannerMode::Star ? 300 : 5000);
+        PlanOutcome<Point<int>> outcome = rrt.plan(options);
+        ASSERT_EQ(outcome.status, PlanStatus::Found) << "mode " << static_cast<int>(mode);
+        EXPECT_GT(outcome.prunes, 0u);
+        EXPECT_LE(outcome.nodes, options.maxTreeNodes);
+        EXPECT_EQ(expectConsistentTree(rrt.getTree()), static_cast<std::size_t>(rrt.nodeCount()));
+        expectFreeEdges(rrt.getTree(), rrt.getCollisionChecker());
+    }
+}
+
+TEST(TreeStore, ByteBoundBelowWhatTheTreesNeedIsRejected) {
+    auto setup = makeWarehouse();
+    RRTPlanner<int> rrt(*setup, 4);
+    int nodes = rrt.nodeCount();
+    PlanOptions options;
+    options.nodeBudget = 4000;
+    options.maxTreeBytes = 1;
+    PlanOutcome<Point<int>> outcome = rrt.plan(options);
+    EXPECT_EQ(outcome.status, PlanStatus::InvalidOptions);
+    EXPECT_EQ(rrt.nodeCount(), nodes);
+    EXPECT_EQ(outcome.prunes, 0u);
+
+    // The same planner still plans once the bound is lifted
+    options.maxTreeBytes = 0;
+    outcome = rrt.plan(options);
+    EXPECT_EQ(outcome.status, PlanStatus::Found);
+}
+
+TEST(TreeStore, RepairKeepsLinksAndCostsConsistent) {
+    auto setup = makeWarehouse();
+    RRTPlanner<int> rrt(*setup, 6);
+    rrt.setMode(PlannerMode::Star);
+    PlanOptions options;
+    options.nodeBudget = 8000;
+    PlanOutcome<Point<int>> outcome = rrt.plan(options);
+    ASSERT_EQ(outcome.status, PlanStatus::Found);
+
+    // Drop a pallet on the path, so edges are blocked and nodes orphaned
+    ObstacleBatch batch;
+    const Point<int>& middle = outcome.path[outcome.path.size() / 2];
+    batch.addCircle(middle.getX(), middle.getY(), 20);
+    RepairStats repair = rrt.addObstacles(batch);
+    EXPECT_GT(repair.edgesBlocked, 0u);
+    EXPECT_GT(repair.orphaned, 0u);
+    EXPECT_EQ(expectConsistentTree(rrt.getTree()), static_cast<std::size_t>(rrt.nodeCount()));
+    expectFreeEdges(rrt.getTree(), rrt.getCollisionChecker());
+
+    // The repaired tree grows on, around the pallet
+    options.nodeBudget = rrt.nodeCount() + 8000;
+    outcome = rrt.plan(options);
+    ASSERT_EQ(outcome.status, PlanStatus::Found);
+    EXPECT_EQ(expectConsistentTree(rrt.getTree()), static_cast<std::size_t>(rrt.nodeCount()));
+    expectFreeEdges(rrt.getTree(), rrt.getCollisionChecker());
+}
+
+TEST(PathSmoother, KeepsThreeDimensionalPathsOutOfTheVoxels) {
+    // A wall 150 high across the whole arena; the path climbs over it
+    ::Setup<int> setup(10, 10, 10, 1000, 1000, 300, Point<int>(100, 500, 50), Point<int>(900, 500, 50), 50);
+    setup.addBox(Point<int>(450, 0, 0), Point<int>(550, 999, 150));
+    RRTPlanner<int> rrt(setup, 1);
+    const VoxelMap* volume = rrt.getVolume();
+    ASSERT_NE(volume, nullptr);
+    auto segmentFree = [&](const Point<int>& a, const Point<int>& b) {
+        double inv = 1.0 / setup.dim;
+        return volume->segmentFree(a.getX() * inv, a.getY() * inv, a.getZ() * inv, b.getX() * inv, b.getY() * inv, b.getZ() * inv);
+    };
+    std::vector<Point<int>> path = {Point<int>(100, 500, 50), Point<int>(100, 500, 250), Point<int>(300, 500, 250),
+                                    Point<int>(500, 500, 250), Point<int>(700, 500, 250), Point<int>(900, 500, 250),
+                                    Point<int>(900, 500, 50)};
+    for (std::size_t i = 1; i < path.size(); ++i) ASSERT_TRUE(segmentFree(path[i - 1], path[i])) << "input edge " << i;
+
+    for (bool spline : {false, true}) {
+        SmoothingOptions options;
+        options.spline = spline;
+        SmoothingReport report;
+        std::vector<Point<int>> out = PathSmoother<Point<int>>(rrt.getCollisionChecker(), setup.dim, options, volume).smooth(path, report);
+        // The 2D grid holds the wall's floor projection and would keep the climb-and-cross route
+        // (966 long); the voxels let the shortcuts arc over it
+        EXPECT_LT(report.lengthAfter, 900) << "spline " << spline;
+        int top = 0;
+        for (std::size_t i = 1; i < out.size(); ++i) {
+            EXPECT_TRUE(segmentFree(out[i - 1], out[i])) << "spline " << spline << ", edge " << i;
+            top = std::max(top, out[i].getZ());
+        }
+        EXPECT_GT(top, 150) << "spline " << spline;
+    }
+}
+
+TEST(PickList, OrderStopsIsCloseToTheBestOrder) {
+    std::mt19937 gen(8);
+    std::uniform_real_distribution<double> coord(0, 1000);
+    const int trials = 200;
+    int optimal = 0;
+    double ratios = 0;
+    for (int trial = 0; trial < trials; ++trial) {
+        std::size_t n = 2 + trial % 7;
+        std::vector<double> x(n), y(n), costs(n * n);
+        for (std::size_t i = 0; i < n; ++i) {
+            x[i] = coord(gen);
+            y[i] = coord(gen);
+        }
+        for (std::size_t i = 0; i < n; ++i) {
+            for (std::size_t j = 0; j < n; ++j) costs[i * n + j] = std::hypot(x[i] - x[j], y[i] - y[j]);
+        }
+        std::vector<std::size_t> order = orderStops(costs, n);
+
+        // An open tour from stop 0 through every stop once
+        ASSERT_EQ(order.size(), n);
+        EXPECT_EQ(order[0], 0u);
+        std::vector<std::size_t> sorted = order;
+        std::sort(sorted.begin(), sorted.end());
+        for (std::size_t i = 0; i < n; ++i) ASSERT_EQ(sorted[i], i);
+
+        // Brute force over every order from stop 0
+        std::vector<std::size_t> candidate(n);
+        std::iota(candidate.begin(), candidate.end(), 0);
+        double best = std::numeric_limits<double>::infinity();
+        do {
+            best = std::min(best, tourCost(costs, n, candidate));
+        } while (std::next_permutation(candidate.begin() + 1, candidate.end()));
+        double cost = tourCost(costs, n, order);
+        EXPECT_GE(cost, best - 1e-9);
+        optimal += cost <= best + 1e-9;
+        ratios += cost / best;
+
+        // 2-opt left no reversal of a stretch that shortens the tour
+        for (std::size_t i = 1; i + 1 < n; ++i) {
+            for (std::size_t j = i + 1; j < n; ++j) {
+                std::vector<std::size_t> reversed = order;
+                std::reverse(reversed.begin() + i, reversed.begin() + j + 1);
+                EXPECT_GE(tourCost(costs, n, reversed), cost - 1e-9) << "trial " << trial << ": reversing " << i << ".." << j;
+            }
+        }
+    }
+    // A heuristic: mostly the best order, and a few percent off it on average
+    EXPECT_GE(optimal, trials * 8 / 10);
+    EXPECT_LE(ratios / trials, 1.02);
+}
+
+TEST(PlannerPortfolio, LabelsEveryPlannerMode) {
+    auto setup = makeWarehouse();
+    PortfolioOptions options;
+    options.planners = 2;
+    options.threads = 1;
+    options.entries = {{PlannerMode::Lazy, PortfolioSampler::Uniform, 1.0}};
+    PortfolioResult<int> result = PlannerPortfolio<int>(*setup, options).run();
+    ASSERT_TRUE(result.planner);
+    EXPECT_EQ(result.label, "lazy/" + std::string(result.planner->getSampler().name()) + "/x1");
+}
+
+TEST(PlanningService, UnanswerableQueriesDoNotGrowTheRoadmapForever) {
+    // A walled-in room: its middle is free but cannot be reached from outside
+    auto setup = std::make_unique<::Setup<int>>(10, 10, 1000, 1000, Point<int>(10, 10), Point<int>(950, 950), 50);
+    auto addRect = [&](int x0, int y0, int x1, int y1) {
+        setup->addObstacle({Point<int>(x0, y0), Point<int>(x1, y0), Point<int>(x1, y1), Point<int>(x0, y1)});
+    };
+    addRect(400, 400, 600, 420);
+    addRect(400, 580, 600, 600);
+    addRect(400, 400, 420, 600);
+    addRect(580, 400, 600, 600);
+
+    std::atomic<int> found{0};
+    PlanningService<int> service(*setup, 1, [&](const PlanResult<int>& result) { found += result.found; },
+                                 500, 200, 2, 1500);
+    std::size_t built = service.getRoadmap().nodeCount();
+
+    // A goal inside a wall fails without growing the roadmap
+    for (std::uint64_t id = 0; id < 50; ++id) service.submit({id, Point<int>(50, 50), Point<int>(500, 410)});
+    service.drain();
+    EXPECT_EQ(service.getRoadmap().nodeCount(), built);
+    EXPECT_EQ(service.failedCount(), 50u);
+
+    // A free goal in the room grows the roadmap up to its cap and no further
+    for (std::uint64_t id = 50; id < 150; ++id) service.submit({id, Point<int>(50, 50), Point<int>(500, 500)});
+    service.drain();
+    EXPECT_LE(service.getRoadmap().nodeCount(), 1500u);
+    EXPECT_EQ(service.failedCount(), 150u);
+
+    // Reachable queries are still answered
+    service.submit({150, Point<int>(50, 50), Point<int>(950, 950)});
+    service.drain();
+    EXPECT_EQ(service.answeredCount(), 1u);
+    EXPECT_EQ(found.load(), 1);
+}
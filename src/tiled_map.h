@@ -0,0 +1,307 @@
+#pragma once
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <cctype>
+#include <cerrno>
+#include <algorithm>
+
+// On-disk occupancy map in the tile layout of OccupancyGrid (.rrtmap).
+//
+//   header | tile table | padding to a page boundary | data tiles
+//
+// The table holds one uint32 per 64x64 tile, tiles in row-major order: EmptyTile, FullTile, or
+// FirstDataTile + i for the i-th data tile. A data tile is the tile's 64 words exactly as
+// OccupancyGrid stores them (one 64-bit word per tile row, bit x for column x), so a mapped
+// file is used in place without decoding. Empty and full tiles take no data, which keeps large
+// sites with open floor or solid blocks small. Integers are stored in native (little-endian)
+// byte order.
+namespace tiled_map {
+
+constexpr char Magic[8] = {'R', 'R', 'T', 'M', 'A', 'P', '0', '1'};
+constexpr std::uint32_t Version = 1;
+constexpr int TileBits = 6;
+constexpr int TileSize = 1 << TileBits;
+constexpr std::size_t TileBytes = TileSize * sizeof(std::uint64_t);
+constexpr std::size_t PageSize = 4096;
+
+constexpr std::uint32_t EmptyTile = 0;
+constexpr std::uint32_t FullTile = 1;
+constexpr std::uint32_t FirstDataTile = 2;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t tileSize;
+    std::int32_t cols, rows;
+    double cellSize;
+    std::uint64_t dataTiles;
+    std::uint64_t dataOffset;
+};
+
+// The words of a full tile
+struct TileWords {
+    std::uint64_t words[TileSize];
+    constexpr explicit TileWords(std::uint64_t fill) : words() {
+        for (std::uint64_t& w : words) w = fill;
+    }
+};
+inline constexpr TileWords FullTileWords{~std::uint64_t(0)};
+
+inline std::size_t tilesAlong(int cells) { return (static_cast<std::size_t>(cells) + TileSize - 1) >> TileBits; }
+
+}  // namespace tiled_map
+
+// Read-only view of a .rrtmap file, memory-mapped private and writable: tiles are paged in by
+// the kernel when first touched, and writes (e.g. obstacles added at run time) go to private
+// copies of the touched pages, never back to the file.
+class TiledMapFile {
+    int fd = -1;
+    unsigned char* base = nullptr;
+    std::size_t length = 0;
+    tiled_map::Header header{};
+    const std::uint32_t* table = nullptr;
+
+    TiledMapFile() = default;
+
+public:
+    ~TiledMapFile() {
+        if (base) munmap(base, length);
+        if (fd >= 0) close(fd);
+    }
+    TiledMapFile(const TiledMapFile&) = delete;
+    TiledMapFile& operator=(const TiledMapFile&) = delete;
+
+    // Null (with the reason in 'error') if the file cannot be mapped or is not a valid map
+    static std::unique_ptr<TiledMapFile> open(const std::string& path, std::string& error) {
+        using namespace tiled_map;
+        std::unique_ptr<TiledMapFile> map(new TiledMapFile());
+        map->fd = ::open(path.c_str(), O_RDONLY);
+        struct stat info;
+        if (map->fd < 0 || fstat(map->fd, &info) != 0) {
+            error = "cannot open " + path + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        map->length = static_cast<std::size_t>(info.st_size);
+        if (map->length < sizeof(Header)) {
+            error = path + " is too short for a map header";
+            return nullptr;
+        }
+        void* p = mmap(nullptr, map->length, PROT_READ | PROT_WRITE, MAP_PRIVATE, map->fd, 0);
+        if (p == MAP_FAILED) {
+            error = "cannot map " + path + ": " + std::strerror(errno);
+            return nullptr;
+        }
+        map->base = static_cast<unsigned char*>(p);
+        // Tiles are visited in planner order, not file order: read ahead would only waste memory
+        madvise(map->base, map->length, MADV_RANDOM);
+
+        Header& h = map->header;
+        std::memcpy(&h, map->base, sizeof(Header));
+        if (std::memcmp(h.magic, Magic, sizeof(Magic)) != 0 || h.version != Version || h.tileSize != TileSize) {
+            error = path + " is not a version " + std::to_string(Version) + " tiled map";
+            return nullptr;
+        }
+        // Each bound is checked against what is left of the one before, so a corrupt header cannot
+        // overflow its way past them
+        if (h.cols < 0 || h.rows < 0 || !(h.cellSize > 0)) {
+            error = path + " has an inconsistent header";
+            return nullptr;
+        }
+        std::size_t tiles = map->tileCount();
+        if (h.dataOffset < sizeof(Header) || h.dataOffset % PageSize != 0 ||
+            tiles > (h.dataOffset - sizeof(Header)) / sizeof(std::uint32_t)) {
+            error = path + " has an inconsistent header";
+            return nullptr;
+        }
+        if (h.dataOffset > map->length || h.dataTiles > (map->length - h.dataOffset) / TileBytes) {
+            error = path + " is truncated";
+            return nullptr;
+        }
+        map->table = reinterpret_cast<const std::uint32_t*>(map->base + sizeof(Header));
+        for (std::size_t t = 0; t < tiles; ++t) {
+            if (map->table[t] >= FirstDataTile + h.dataTiles) {
+                error = path + " refers to a missing data tile";
+                return nullptr;
+            }
+        }
+        return map;
+    }
+
+    int cols() const { return header.cols; }
+    int rows() const { return header.rows; }
+    double cellSize() const { return header.cellSize; }
+    std::size_t tilesX() const { return tiled_map::tilesAlong(header.cols); }
+    std::size_t tilesY() const { return tiled_map::tilesAlong(header.rows); }
+    std::size_t tileCount() const { return tilesX() * tilesY(); }
+    std::size_t dataTileCount() const { return header.dataTiles; }
+    std::size_t fileBytes() const { return length; }
+
+    // Table entry of a tile: EmptyTile, FullTile or a data tile
+    std::uint32_t entry(std::size_t tile) const { return table[tile]; }
+    // The 64 words of a data tile entry, inside the private mapping
+    std::uint64_t* tileWords(std::uint32_t entry) {
+        return reinterpret_cast<std::uint64_t*>(base + header.dataOffset + (entry - tiled_map::FirstDataTile) * tiled_map::TileBytes);
+    }
+};
+
+// Streams a .rrtmap file row by row, so importing a huge occupancy image only ever holds one
+// band of 64 rows in memory. Data tiles are written as each band completes; the table and the
+// header follow in finish().
+class TiledMapWriter {
+    std::ofstream out;
+    int numCols, numRows;
+    double cellSize;
+    std::size_t tilesX;
+    std::vector<std::uint32_t> table;
+    std::vector<std::uint64_t> band;  // tilesX tiles of 64 words
+    std::uint64_t dataTiles = 0;
+    std::uint64_t dataOffset;
+    int row = 0;
+
+    void flushBand() {
+        using namespace tiled_map;
+        for (std::size_t tx = 0; tx < tilesX; ++tx) {
+            const std::uint64_t* words = &band[tx * TileSize];
+            // Only whole tiles inside the map can be full: bits past the map edge stay clear
+            bool empty = std::all_of(words, words + TileSize, [](std::uint64_t w) { return w == 0; });
+            bool full = std::all_of(words, words + TileSize, [](std::uint64_t w) { return w == ~std::uint64_t(0); });
+            if (empty || full) {
+                table.push_back(empty ? EmptyTile : FullTile);
+            } else {
+                table.push_back(static_cast<std::uint32_t>(FirstDataTile + dataTiles++));
+                out.write(reinterpret_cast<const char*>(words), TileBytes);
+            }
+        }
+        std::fill(band.begin(), band.end(), 0);
+    }
+
+public:
+    TiledMapWriter(const std::string& path, int cols, int rows, double cellSize)
+        : out(path, std::ios::binary | std::ios::trunc), numCols(cols), numRows(rows), cellSize(cellSize),
+          tilesX(tiled_map::tilesAlong(cols)), band(tilesX * tiled_map::TileSize, 0) {
+        using namespace tiled_map;
+        std::size_t tableBytes = tilesX * tilesAlong(rows) * sizeof(std::uint32_t);
+        dataOffset = (sizeof(Header) + tableBytes + PageSize - 1) / PageSize * PageSize;
+        table.reserve(tilesX * tilesAlong(rows));
+        out.seekp(static_cast<std::streamoff>(dataOffset));
+    }
+
+    bool good() const { return static_cast<bool>(out); }
+    int cols() const { return numCols; }
+    int rows() const { return numRows; }
+
+    // Append the next row; occupied[x] is nonzero for obstacle cells, x in [0, cols)
+    void addRow(const std::uint8_t* occupied) {
+        using namespace tiled_map;
+        int lane = row & (TileSize - 1);
+        for (int x = 0; x < numCols; ++x) {
+            if (occupied[x]) band[((x >> TileBits) << TileBits) + lane] |= std::uint64_t(1) << (x & (TileSize - 1));
+        }
+        if (++row % TileSize == 0) flushBand();
+    }
+
+    // Write the table and header; false if any write failed or rows are missing
+    bool finish() {
+        using namespace tiled_map;
+        if (row != numRows) return false;
+        if (row % TileSize != 0) flushBand();
+        Header h{};
+        std::memcpy(h.magic, Magic, sizeof(Magic));
+        h.version = Version;
+        h.tileSize = TileSize;
+        h.cols = numCols;
+        h.rows = numRows;
+        h.cellSize = cellSize;
+        h.dataTiles = dataTiles;
+        h.dataOffset = dataOffset;
+        // A map without data tiles still needs the file to reach the data offset
+        out.seekp(0, std::ios::end);
+        if (static_cast<std::uint64_t>(out.tellp()) < dataOffset) {
+            out.seekp(static_cast<std::streamoff>(dataOffset - 1));
+            out.put(0);
+        }
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        out.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(std::uint32_t));
+        out.close();
+        return !out.fail();
+    }
+};
+
+// Convert a PGM occupancy image (P5 8/16-bit or P2) into a .rrtmap file, streaming it band by
+// band. Image row r becomes grid row r; a pixel is an obstacle when it is darker than
+// 'occupiedBelow' on a 0-255 scale (so black walls are obstacles, and the usual white free
+// space and grey unknown space are free).
+inline bool importPgm(const std::string& pgmPath, const std::string& mapPath, double cellSize,
+                      int occupiedBelow, std::string& error) {
+    std::ifstream in(pgmPath, std::ios::binary);
+    if (!in) {
+        error = "cannot open " + pgmPath;
+        return false;
+    }
+    // Header fields are whitespace separated and may be interleaved with '#' comments
+    auto field = [&in]() {
+        std::string token;
+        while (in && token.empty()) {
+            int c = in.get();
+            if (c == '#') {
+                while (in && c != '\n') c = in.get();
+            } else if (c != EOF && !std::isspace(c)) {
+                token += static_cast<char>(c);
+                while (in && !std::isspace(in.peek()) && in.peek() != EOF) token += static_cast<char>(in.get());
+            }
+        }
+        return token;
+    };
+    std::string magic = field();
+    if (magic != "P5" && magic != "P2") {
+        error = pgmPath + " is not a PGM image";
+        return false;
+    }
+    int cols = std::atoi(field().c_str()), rows = std::atoi(field().c_str()), maxValue = std::atoi(field().c_str());
+    if (cols <= 0 || rows <= 0 || maxValue <= 0 || maxValue > 65535) {
+        error = pgmPath + " has an invalid PGM header";
+        return false;
+    }
+    if (magic == "P5") in.get();  // the single whitespace before the raster
+
+    TiledMapWriter writer(mapPath, cols, rows, cellSize);
+    if (!writer.good()) {
+        error = "cannot write " + mapPath;
+        return false;
+    }
+    int bytesPerPixel = maxValue > 255 ? 2 : 1;
+    std::vector<unsigned char> raw(static_cast<std::size_t>(cols) * bytesPerPixel);
+    std::vector<std::uint8_t> occupied(cols);
+    for (int y = 0; y < rows; ++y) {
+        for (int x = 0; x < cols; ++x) {
+            long value;
+            if (magic == "P2") {
+                value = std::atol(field().c_str());
+            } else {
+                if (x == 0) in.read(reinterpret_cast<char*>(raw.data()), static_cast<std::streamsize>(raw.size()));
+                value = bytesPerPixel == 2 ? (raw[2 * x] << 8) | raw[2 * x + 1] : raw[x];
+            }
+            occupied[x] = value * 255 < static_cast<long>(occupiedBelow) * maxValue;
+        }
+        if (!in) {
+            error = pgmPath + " ends before its last row";
+            return false;
+        }
+        writer.addRow(occupied.data());
+    }
+    if (!writer.finish()) {
+        error = "cannot write " + mapPath;
+        return false;
+    }
+    return true;
+}
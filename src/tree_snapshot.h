@@ -0,0 +1,205 @@
+#pragma once
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include "tiled_map.h"
+#include "arena_setup.h"
+
+// Binary snapshot of a planner run (.rrtsnap), for inspecting trees from headless runs offline.
+//
+//   header | node x | node y | node parent | path x | path y | tile table | data tiles
+//
+// Coordinates are float32 world units (the floor projection in 3D), parents uint32 with
+// kNoNode for roots and dropped nodes, in node id (insertion) order. Nodes from goalTreeBegin on
+// are the Connect-mode goal tree, whose parents are ids within that tree. The occupancy grid
+// is stored as in a .rrtmap file: one table entry per 64x64 tile (EmptyTile, FullTile or
+// FirstDataTile + i) followed by the data tiles' words, so open floor and solid blocks take
+// 4 bytes per tile. Integers are in native (little-endian) byte order.
+namespace tree_snapshot {
+
+constexpr char Magic[8] = {'R', 'R', 'T', 'S', 'N', 'A', 'P', '1'};
+constexpr std::uint32_t Version = 1;
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::int32_t cols, rows;
+    std::uint32_t nodes, goalTreeBegin, pathPoints;
+    std::uint64_t dataTiles;
+    double cellSize;
+    float start[2], target[2];
+};
+
+}  // namespace tree_snapshot
+
+struct TreeSnapshot {
+    int cols = 0, rows = 0;
+    double cellSize = 1;
+    float start[2] = {0, 0}, target[2] = {0, 0};
+    std::vector<float> x, y;
+    std::vector<std::uint32_t> parent;
+    std::uint32_t goalTreeBegin = 0;
+    std::vector<float> pathX, pathY;
+    std::vector<std::uint32_t> tileTable;
+    std::vector<std::uint64_t> tileData;
+
+    std::size_t tilesX() const { return tiled_map::tilesAlong(cols); }
+    std::size_t nodeCount() const { return x.size(); }
+
+    // Words of tile t (64 rows of 64 cells), or null for an empty tile
+    const std::uint64_t* tileWords(std::size_t t) const {
+        std::uint32_t entry = tileTable[t];
+        if (entry == tiled_map::EmptyTile) return nullptr;
+        if (entry == tiled_map::FullTile) return tiled_map::FullTileWords.words;
+        return &tileData[static_cast<std::size_t>(entry - tiled_map::FirstDataTile) * tiled_map::TileSize];
+    }
+
+    bool isObstacle(int cx, int cy) const {
+        const std::uint64_t* words = tileWords((cy >> tiled_map::TileBits) * tilesX() + (cx >> tiled_map::TileBits));
+        return words && (words[cy & (tiled_map::TileSize - 1)] >> (cx & (tiled_map::TileSize - 1)) & 1);
+    }
+
+    bool save(const std::string& path, std::string& error) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        tree_snapshot::Header h{};
+        std::memcpy(h.magic, tree_snapshot::Magic, sizeof(h.magic));
+        h.version = tree_snapshot::Version;
+        h.cols = cols;
+        h.rows = rows;
+        h.nodes = static_cast<std::uint32_t>(x.size());
+        h.goalTreeBegin = goalTreeBegin;
+        h.pathPoints = static_cast<std::uint32_t>(pathX.size());
+        h.dataTiles = tileData.size() / tiled_map::TileSize;
+        h.cellSize = cellSize;
+        std::copy(start, start + 2, h.start);
+        std::copy(target, target + 2, h.target);
+        out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+        writeArray(out, x);
+        writeArray(out, y);
+        writeArray(out, parent);
+        writeArray(out, pathX);
+        writeArray(out, pathY);
+        writeArray(out, tileTable);
+        writeArray(out, tileData);
+        if (!out) error = "cannot write " + path;
+        return static_cast<bool>(out);
+    }
+
+    // Null (with a reason in 'error') if the file cannot be read or is not a snapshot
+    static std::unique_ptr<TreeSnapshot> load(const std::string& path, std::string& error) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in) {
+            error = "cannot open " + path;
+            return nullptr;
+        }
+        tree_snapshot::Header h{};
+        in.read(reinterpret_cast<char*>(&h), sizeof(h));
+        if (!in || std::memcmp(h.magic, tree_snapshot::Magic, sizeof(h.magic)) != 0 || h.version != tree_snapshot::Version) {
+            error = path + " is not a version " + std::to_string(tree_snapshot::Version) + " .rrtsnap file";
+            return nullptr;
+        }
+        auto snapshot = std::make_unique<TreeSnapshot>();
+        snapshot->cols = h.cols;
+        snapshot->rows = h.rows;
+        snapshot->cellSize = h.cellSize;
+        std::copy(h.start, h.start + 2, snapshot->start);
+        std::copy(h.target, h.target + 2, snapshot->target);
+        snapshot->goalTreeBegin = h.goalTreeBegin;
+        std::size_t tiles = snapshot->tilesX() * tiled_map::tilesAlong(h.rows);
+        bool ok = readArray(in, snapshot->x, h.nodes) && readArray(in, snapshot->y, h.nodes) && readArray(in, snapshot->parent, h.nodes) &&
+                  readArray(in, snapshot->pathX, h.pathPoints) && readArray(in, snapshot->pathY, h.pathPoints) &&
+                  readArray(in, snapshot->tileTable, tiles) && readArray(in, snapshot->tileData, h.dataTiles * tiled_map::TileSize);
+        std::uint64_t maxEntry = tiled_map::FirstDataTile + h.dataTiles;
+        if (!ok || h.goalTreeBegin > h.nodes ||
+            std::any_of(snapshot->tileTable.begin(), snapshot->tileTable.end(), [&](std::uint32_t e) { return e >= maxEntry; }) ||
+            !snapshot->parentsInRange()) {
+            error = path + " is truncated or corrupt";
+            return nullptr;
+        }
+        return snapshot;
+    }
+
+private:
+    // Goal-tree parents index the goal tree, which starts at goalTreeBegin
+    bool parentsInRange() const {
+        for (std::size_t id = 0; id < parent.size(); ++id) {
+            std::size_t limit = id < goalTreeBegin ? goalTreeBegin : parent.size() - goalTreeBegin;
+            if (parent[id] != kNoNode && parent[id] >= limit) return false;
+        }
+        return true;
+    }
+
+    template <typename V>
+    static void writeArray(std::ofstream& out, const std::vector<V>& values) {
+        out.write(reinterpret_cast<const char*>(values.data()), static_cast<std::streamsize>(values.size() * sizeof(V)));
+    }
+    template <typename V>
+    static bool readArray(std::ifstream& in, std::vector<V>& values, std::size_t n) {
+        values.resize(n);
+        in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(n * sizeof(V)));
+        return static_cast<bool>(in);
+    }
+};
+
+// Copy the tree (and the Connect-mode goal tree, if given), a path and the arena of a finished
+// run. The planner must not be running (take the snapshot after start()/plan() returned); the
+// copy is one pass over the nodes and one over the tiles, so inspection never slows planning.
+template <typename T>
+TreeSnapshot captureSnapshot(const Setup<T>& setup, const TreeStore<T>& tree, const std::vector<Point<T>>& path,
+                             const TreeStore<T>* goalTree = nullptr) {
+    TreeSnapshot snapshot;
+    const OccupancyGrid& grid = setup.arena;
+    snapshot.cols = grid.cols();
+    snapshot.rows = grid.rows();
+    snapshot.cellSize = setup.dim;
+    snapshot.start[0] = static_cast<float>(setup.start.getX());
+    snapshot.start[1] = static_cast<float>(setup.start.getY());
+    snapshot.target[0] = static_cast<float>(setup.target.getX());
+    snapshot.target[1] = static_cast<float>(setup.target.getY());
+
+    std::size_t nodes = tree.size() + (goalTree ? goalTree->size() : 0);
+    snapshot.x.reserve(nodes);
+    snapshot.y.reserve(nodes);
+    snapshot.parent.reserve(nodes);
+    auto addTree = [&](const TreeStore<T>& store) {
+        for (NodeId id = 0; id < store.size(); ++id) {
+            snapshot.x.push_back(static_cast<float>(store.x(id)));
+            snapshot.y.push_back(static_cast<float>(store.y(id)));
+            snapshot.parent.push_back(store.parent(id));
+        }
+    };
+    addTree(tree);
+    snapshot.goalTreeBegin = static_cast<std::uint32_t>(snapshot.x.size());
+    if (goalTree) addTree(*goalTree);
+    for (const Point<T>& p : path) {
+        snapshot.pathX.push_back(static_cast<float>(p.getX()));
+        snapshot.pathY.push_back(static_cast<float>(p.getY()));
+    }
+
+    using namespace tiled_map;
+    std::size_t tilesX = tilesAlong(grid.cols()), tilesY = tilesAlong(grid.rows());
+    snapshot.tileTable.reserve(tilesX * tilesY);
+    std::uint64_t words[TileSize];
+    for (std::size_t ty = 0; ty < tilesY; ++ty) {
+        for (std::size_t tx = 0; tx < tilesX; ++tx) {
+            int x = static_cast<int>(tx << TileBits), y0 = static_cast<int>(ty << TileBits);
+            for (int r = 0; r < TileSize; ++r) {
+                words[r] = y0 + r < grid.rows() ? grid.rowWord(x, y0 + r) : 0;
+            }
+            bool empty = std::all_of(words, words + TileSize, [](std::uint64_t w) { return w == 0; });
+            bool full = std::all_of(words, words + TileSize, [](std::uint64_t w) { return w == ~std::uint64_t(0); });
+            if (empty || full) {
+                snapshot.tileTable.push_back(empty ? EmptyTile : FullTile);
+            } else {
+                snapshot.tileTable.push_back(static_cast<std::uint32_t>(FirstDataTile + snapshot.tileData.size() / TileSize));
+                snapshot.tileData.insert(snapshot.tileData.end(), words, words + TileSize);
+            }
+        }
+    }
+    return snapshot;
+}
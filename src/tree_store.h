@@ -0,0 +1,177 @@
+#pragma once
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <atomic>
+
+// 2D or 3D point of scalar T (arena_setup.h); the planner's points are 3D, with z = 0 in 2D arenas
+template <typename T, int D = 3>
+class Point;
+
+// Index of a node inside a TreeStore. The root is always node 0.
+using NodeId = std::uint32_t;
+constexpr NodeId kNoNode = std::numeric_limits<NodeId>::max();
+
+// Flat, index-addressed storage for the RRT tree.
+// Nodes live in fixed-size chunks laid out as struct-of-arrays, so coordinate scans walk
+// contiguous memory and adding a node never moves existing ones (references stay valid).
+// Children are kept as an intrusive first-child / next-sibling list, so inserting a node
+// does not allocate anything besides the occasional new chunk. Each node also carries its
+// path cost from the root, which RRT* keeps up to date when it rewires. A 2D store keeps no z
+// array at all (28 bytes per node for 4-byte T); the coordinate arrays start on cache lines,
+// so SIMD scans over chunkX()/chunkY() need no peeling.
+// Detached nodes (no parent, not the root) can be handed back with reclaimDetached(); add()
+// reuses their slots before it grows the store, so a pruned tree stays in a fixed footprint.
+// add() must be serialized by the caller; the chunk table has a fixed size, so other threads
+// may read the coordinates and parent of any node id that was published to them.
+template <typename T>
+class TreeStore {
+public:
+    static constexpr std::size_t ChunkBits = 12;
+    static constexpr std::size_t ChunkSize = std::size_t(1) << ChunkBits;
+    static constexpr std::size_t MaxChunks = 4096;
+
+private:
+    struct Chunk {
+        alignas(64) T x[ChunkSize];
+        alignas(64) T y[ChunkSize];
+        NodeId parent[ChunkSize];
+        NodeId firstChild[ChunkSize];
+        NodeId nextSibling[ChunkSize];
+        double cost[ChunkSize];
+        std::unique_ptr<T[]> z;   // 3D stores only
+    };
+
+    int dims;
+    std::unique_ptr<std::unique_ptr<Chunk>[]> chunks;
+    std::size_t chunksUsed = 0;
+    std::atomic<std::size_t> count{0};
+    std::vector<NodeId> freeSlots;
+
+    Chunk& chunkOf(NodeId id) { return *chunks[id >> ChunkBits]; }
+    const Chunk& chunkOf(NodeId id) const { return *chunks[id >> ChunkBits]; }
+    static std::size_t slot(NodeId id) { return id & (ChunkSize - 1); }
+
+public:
+    // dims is 2 or 3; a 2D store drops the z of the points added and reads it back as 0
+    explicit TreeStore(int dims = 3) : dims(dims), chunks(new std::unique_ptr<Chunk>[MaxChunks]) {}
+    TreeStore(const TreeStore&) = delete;
+    TreeStore& operator=(const TreeStore&) = delete;
+
+    // Append a node under 'parent' (kNoNode for the root) and return its id,
+    // or kNoNode once the store is full
+    NodeId add(const Point<T>& point, NodeId parent, double cost = 0) {
+        std::size_t n = count.load(std::memory_order_relaxed);
+        NodeId id = static_cast<NodeId>(n);
+        if (!freeSlots.empty()) {
+            id = freeSlots.back();
+            freeSlots.pop_back();
+        } else if ((n >> ChunkBits) == chunksUsed) {
+            if (chunksUsed == MaxChunks) return kNoNode;
+            auto chunk = std::make_unique<Chunk>();
+            if (dims == 3) chunk->z = std::make_unique<T[]>(ChunkSize);
+            chunks[chunksUsed++] = std::move(chunk);
+        }
+        Chunk& c = chunkOf(id);
+        std::size_t s = slot(id);
+        c.x[s] = point.getX();
+        c.y[s] = point.getY();
+        if (c.z) c.z[s] = point.getZ();
+        c.parent[s] = parent;
+        c.firstChild[s] = kNoNode;
+        c.nextSibling[s] = kNoNode;
+        c.cost[s] = cost;
+        if (parent != kNoNode) {
+            Chunk& pc = chunkOf(parent);
+            c.nextSibling[s] = pc.firstChild[slot(parent)];
+            pc.firstChild[slot(parent)] = id;
+        }
+        if (id == n) count.store(n + 1, std::memory_order_release);
+        return id;
+    }
+
+    // Make every detached node's slot available to add() again and return how many there are.
+    // The caller must have removed them from its index; nothing may refer to their ids after this.
+    std::size_t reclaimDetached() {
+        freeSlots.clear();
+        freeSlots.reserve(size());
+        for (NodeId id = static_cast<NodeId>(size()); id-- > 1;) {
+            if (parent(id) == kNoNode) freeSlots.push_back(id);
+        }
+        return freeSlots.size();
+    }
+    // Slots waiting for reuse
+    std::size_t freeCount() const { return freeSlots.size(); }
+
+    Point<T> point(NodeId id) const {
+        const Chunk& c = chunkOf(id);
+        std::size_t s = slot(id);
+        return Point<T>(c.x[s], c.y[s], c.z ? c.z[s] : T(0));
+    }
+    T x(NodeId id) const { return chunkOf(id).x[slot(id)]; }
+    T y(NodeId id) const { return chunkOf(id).y[slot(id)]; }
+    T z(NodeId id) const {
+        const Chunk& c = chunkOf(id);
+        return c.z ? c.z[slot(id)] : T(0);
+    }
+    NodeId parent(NodeId id) const { return chunkOf(id).parent[slot(id)]; }
+    NodeId firstChild(NodeId id) const { return chunkOf(id).firstChild[slot(id)]; }
+    NodeId nextSibling(NodeId id) const { return chunkOf(id).nextSibling[slot(id)]; }
+    double cost(NodeId id) const { return chunkOf(id).cost[slot(id)]; }
+    void setCost(NodeId id, double cost) { chunkOf(id).cost[slot(id)] = cost; }
+
+    // Move 'id' (with its subtree) under 'newParent'; costs are left to the caller.
+    // Serialized like add(), and not safe against concurrent readers of the parent links.
+    void setParent(NodeId id, NodeId newParent) {
+        NodeId oldParent = parent(id);
+        if (oldParent != kNoNode) {
+            NodeId* link = &chunkOf(oldParent).firstChild[slot(oldParent)];
+            while (*link != id) {
+                link = &chunkOf(*link).nextSibling[slot(*link)];
+            }
+            *link = nextSibling(id);
+        }
+        chunkOf(id).parent[slot(id)] = newParent;
+        chunkOf(id).nextSibling[slot(id)] = kNoNode;
+        if (newParent != kNoNode) {
+            chunkOf(id).nextSibling[slot(id)] = firstChild(newParent);
+            chunkOf(newParent).firstChild[slot(newParent)] = id;
+        }
+    }
+
+    template <typename Visit>
+    void forEachChild(NodeId id, Visit&& visit) const {
+        for (NodeId c = firstChild(id); c != kNoNode; c = nextSibling(c)) {
+            visit(c);
+        }
+    }
+
+    // Raw coordinate arrays of one chunk, for linear (vectorizable) scans
+    std::size_t chunkCount() const { return chunksUsed; }
+    std::size_t chunkLength(std::size_t c) const {
+        return c + 1 < chunksUsed ? ChunkSize : size() - (c << ChunkBits);
+    }
+    const T* chunkX(std::size_t c) const { return chunks[c]->x; }
+    const T* chunkY(std::size_t c) const { return chunks[c]->y; }
+
+    // Slots in use or free: node ids are below size()
+    std::size_t size() const { return count.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+    int dimensions() const { return dims; }
+    std::size_t memoryBytes() const { return MaxChunks * sizeof(chunks[0]) + freeSlots.capacity() * sizeof(NodeId) + chunksUsed * chunkBytes(); }
+    std::size_t chunkBytes() const { return sizeof(Chunk) + (dims == 3 ? ChunkSize * sizeof(T) : 0); }
+    // Most that memoryBytes() grows by over the next ChunkSize adds, reclaimDetached() included
+    std::size_t growthBytes() const { return chunkBytes() + (size() + ChunkSize) * sizeof(NodeId); }
+
+    // Drops every node; chunks are released one allocation each, without walking the tree
+    void clear() {
+        for (std::size_t c = 0; c < chunksUsed; ++c) {
+            chunks[c].reset();
+        }
+        chunksUsed = 0;
+        freeSlots.clear();
+        count.store(0, std::memory_order_release);
+    }
+};
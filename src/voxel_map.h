@@ -0,0 +1,207 @@
+#pragma once
+#include <vector>
+#include <unordered_map>
+#include <cmath>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+#include <algorithm>
+
+// Sparse 3D occupancy map for tall arenas.
+// Voxels are grouped into 8x8x8 bricks found through a hash map keyed by brick coordinates;
+// bricks that hold no obstacle are simply absent and bricks that are completely solid are
+// stored as a marker without bits, so memory follows the surface of the occupied volume
+// rather than the bounding box. A partial brick is 8 words, one 64-bit 8x8 slice per z.
+// Everything outside the map's bounds counts as occupied.
+class VoxelMap {
+public:
+    static constexpr int BrickBits = 3;
+    static constexpr int BrickSize = 1 << BrickBits;
+
+private:
+    struct Brick {
+        std::uint64_t slices[BrickSize] = {};
+    };
+
+    static constexpr std::uint32_t FullBrick = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::uint64_t FullSlice = ~std::uint64_t(0);
+
+    int numX = 0, numY = 0, numZ = 0;
+    std::unordered_map<std::uint64_t, std::uint32_t> bricks;
+    std::vector<Brick> storage;
+    std::size_t occupiedCount = 0;
+
+    static std::uint64_t key(int bx, int by, int bz) {
+        return (static_cast<std::uint64_t>(bx) << 42) | (static_cast<std::uint64_t>(by) << 21) | static_cast<std::uint64_t>(bz);
+    }
+    static int lane(int v) { return v & (BrickSize - 1); }
+    static std::uint64_t bitOf(int x, int y) { return std::uint64_t(1) << (lane(y) * BrickSize + lane(x)); }
+
+    // Bits of one slice covering lanes [x0,x1] x [y0,y1]
+    static std::uint64_t sliceMask(int x0, int x1, int y0, int y1) {
+        std::uint64_t row = ((std::uint64_t(1) << (x1 - x0 + 1)) - 1) << x0;
+        std::uint64_t mask = 0;
+        for (int y = y0; y <= y1; ++y) mask |= row << (y * BrickSize);
+        return mask;
+    }
+
+    static std::size_t popcount(std::uint64_t v) {
+        std::size_t n = 0;
+        for (; v; v &= v - 1) ++n;
+        return n;
+    }
+
+    // False if the brick is empty; otherwise 'slot' is its storage slot or FullBrick
+    bool findBrick(int bx, int by, int bz, std::uint32_t& slot) const {
+        auto it = bricks.find(key(bx, by, bz));
+        if (it == bricks.end()) return false;
+        slot = it->second;
+        return true;
+    }
+
+    // Set lanes [x0,x1]x[y0,y1]x[z0,z1] of brick (bx,by,bz)
+    void fillBrick(int bx, int by, int bz, int x0, int x1, int y0, int y1, int z0, int z1) {
+        auto it = bricks.find(key(bx, by, bz));
+        if (it != bricks.end() && it->second == FullBrick) return;
+        bool whole = x0 == 0 && y0 == 0 && z0 == 0 && x1 == BrickSize - 1 && y1 == BrickSize - 1 && z1 == BrickSize - 1;
+        if (it == bricks.end()) {
+            if (whole) {
+                bricks.emplace(key(bx, by, bz), FullBrick);
+                occupiedCount += BrickSize * BrickSize * BrickSize;
+                return;
+            }
+            storage.emplace_back();
+            it = bricks.emplace(key(bx, by, bz), static_cast<std::uint32_t>(storage.size() - 1)).first;
+        }
+
+        Brick& brick = storage[it->second];
+        std::uint64_t mask = sliceMask(x0, x1, y0, y1);
+        bool full = true;
+        for (int z = 0; z < BrickSize; ++z) {
+            if (z >= z0 && z <= z1) {
+                occupiedCount += popcount(mask & ~brick.slices[z]);
+                brick.slices[z] |= mask;
+            }
+            full = full && brick.slices[z] == FullSlice;
+        }
+        // The bits of a brick that became solid are left behind unused; bricks only fill up
+        if (full) it->second = FullBrick;
+    }
+
+public:
+    VoxelMap() = default;
+    VoxelMap(int sizeX, int sizeY, int sizeZ) : numX(sizeX), numY(sizeY), numZ(sizeZ) {}
+
+    int sizeX() const { return numX; }
+    int sizeY() const { return numY; }
+    int sizeZ() const { return numZ; }
+    bool inBounds(int x, int y, int z) const { return x >= 0 && x < numX && y >= 0 && y < numY && z >= 0 && z < numZ; }
+
+    bool isOccupied(int x, int y, int z) const {
+        if (!inBounds(x, y, z)) return true;
+        std::uint32_t slot;
+        if (!findBrick(x >> BrickBits, y >> BrickBits, z >> BrickBits, slot)) return false;
+        return slot == FullBrick || (storage[slot].slices[lane(z)] & bitOf(x, y));
+    }
+
+    // Mark every voxel of the inclusive box as occupied; the box is clipped to the map
+    void setBox(int x0, int y0, int z0, int x1, int y1, int z1) {
+        x0 = std::max(x0, 0), y0 = std::max(y0, 0), z0 = std::max(z0, 0);
+        x1 = std::min(x1, numX - 1), y1 = std::min(y1, numY - 1), z1 = std::min(z1, numZ - 1);
+        if (x0 > x1 || y0 > y1 || z0 > z1) return;
+        for (int bz = z0 >> BrickBits; bz <= z1 >> BrickBits; ++bz) {
+            int lz0 = std::max(z0 - (bz << BrickBits), 0), lz1 = std::min(z1 - (bz << BrickBits), BrickSize - 1);
+            for (int by = y0 >> BrickBits; by <= y1 >> BrickBits; ++by) {
+                int ly0 = std::max(y0 - (by << BrickBits), 0), ly1 = std::min(y1 - (by << BrickBits), BrickSize - 1);
+                for (int bx = x0 >> BrickBits; bx <= x1 >> BrickBits; ++bx) {
+                    int lx0 = std::max(x0 - (bx << BrickBits), 0), lx1 = std::min(x1 - (bx << BrickBits), BrickSize - 1);
+                    fillBrick(bx, by, bz, lx0, lx1, ly0, ly1, lz0, lz1);
+                }
+            }
+        }
+    }
+
+    void setOccupied(int x, int y, int z) { setBox(x, y, z, x, y, z); }
+
+    // Copy with every occupied voxel grown into a cube of 2*cells+1 voxels.
+    // Solid bricks are grown as one box; only voxels of partial bricks are visited one by one.
+    VoxelMap dilated(int cells) const {
+        VoxelMap out(numX, numY, numZ);
+        for (const auto& [k, slot] : bricks) {
+            int bx = static_cast<int>(k >> 42) << BrickBits;
+            int by = static_cast<int>((k >> 21) & 0x1FFFFF) << BrickBits;
+            int bz = static_cast<int>(k & 0x1FFFFF) << BrickBits;
+            if (slot == FullBrick) {
+                out.setBox(bx - cells, by - cells, bz - cells, bx + BrickSize - 1 + cells, by + BrickSize - 1 + cells, bz + BrickSize - 1 + cells);
+                continue;
+            }
+            for (int z = 0; z < BrickSize; ++z) {
+                for (std::uint64_t bits = storage[slot].slices[z]; bits; bits &= bits - 1) {
+                    int bit = 0;
+                    while (!((bits >> bit) & 1)) ++bit;
+                    int x = bx + (bit & (BrickSize - 1)), y = by + (bit >> BrickBits);
+                    out.setBox(x - cells, y - cells, bz + z - cells, x + cells, y + cells, bz + z + cells);
+                }
+            }
+        }
+        return out;
+    }
+
+    std::size_t occupiedVoxels() const { return occupiedCount; }
+    std::size_t brickCount() const { return bricks.size(); }
+
+    // Bytes held by brick bits and the hash table (nodes plus bucket array)
+    std::size_t memoryBytes() const {
+        return storage.capacity() * sizeof(Brick) +
+               bricks.size() * (sizeof(std::uint64_t) + sizeof(std::uint32_t) + 2 * sizeof(void*)) +
+               bricks.bucket_count() * sizeof(void*);
+    }
+
+    // Exact 3D Amanatides-Woo traversal of the voxels crossed by the segment, in voxel units.
+    // As in the 2D CollisionChecker, the start voxel is not tested but must be inside the map.
+    // The brick of the current voxel is looked up once per brick rather than once per voxel,
+    // and steps through absent bricks only do the integer bookkeeping.
+    bool segmentFree(double fx0, double fy0, double fz0, double fx1, double fy1, double fz1) const {
+        int c[3] = {static_cast<int>(std::floor(fx0)), static_cast<int>(std::floor(fy0)), static_cast<int>(std::floor(fz0))};
+        int e[3] = {static_cast<int>(std::floor(fx1)), static_cast<int>(std::floor(fy1)), static_cast<int>(std::floor(fz1))};
+        if (!inBounds(c[0], c[1], c[2])) return false;
+        if (bricks.empty()) return inBounds(e[0], e[1], e[2]);
+
+        double f0[3] = {fx0, fy0, fz0};
+        double d[3] = {fx1 - fx0, fy1 - fy0, fz1 - fz0};
+        int step[3], left[3];
+        double tMax[3], tDelta[3];
+        const double inf = std::numeric_limits<double>::infinity();
+        for (int a = 0; a < 3; ++a) {
+            step[a] = d[a] > 0 ? 1 : -1;
+            tDelta[a] = d[a] != 0 ? 1.0 / std::abs(d[a]) : inf;
+            tMax[a] = d[a] != 0 ? (step[a] > 0 ? c[a] + 1 - f0[a] : f0[a] - c[a]) * tDelta[a] : inf;
+            left[a] = std::abs(e[a] - c[a]);
+        }
+
+        std::uint64_t brickKey = ~std::uint64_t(0);
+        const Brick* brick = nullptr;
+        bool solid = false;
+        while (left[0] + left[1] + left[2] > 0) {
+            // Advance along the axis whose next boundary is nearest, never past the end voxel
+            int axis = -1;
+            for (int a = 0; a < 3; ++a) {
+                if (left[a] > 0 && (axis < 0 || tMax[a] < tMax[axis])) axis = a;
+            }
+            c[axis] += step[axis];
+            tMax[axis] += tDelta[axis];
+            --left[axis];
+
+            if (!inBounds(c[0], c[1], c[2])) return false;
+            std::uint64_t k = key(c[0] >> BrickBits, c[1] >> BrickBits, c[2] >> BrickBits);
+            if (k != brickKey) {
+                brickKey = k;
+                auto it = bricks.find(k);
+                solid = it != bricks.end() && it->second == FullBrick;
+                brick = it != bricks.end() && !solid ? &storage[it->second] : nullptr;
+            }
+            if (solid || (brick && (brick->slices[lane(c[2])] & bitOf(c[0], c[1])))) return false;
+        }
+        return true;
+    }
+};
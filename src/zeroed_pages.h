@@ -0,0 +1,61 @@
+#pragma once
+#include <sys/mman.h>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <new>
+
+// Fixed-size array of zeroed elements backed by an anonymous private mapping.
+// The kernel hands out zero pages on first touch, so an array sized for a whole (possibly huge)
+// arena only costs memory for the pages that are actually written or read. Elements are never
+// constructed or destroyed: they must be plain integers, or lock-free atomics of them, for which
+// all-zero bytes are the value zero.
+template <typename E>
+class ZeroedPages {
+    static_assert(std::is_trivially_destructible<E>::value && std::is_standard_layout<E>::value,
+                  "ZeroedPages holds plain integers or atomics of them");
+
+    E* elements = nullptr;
+    std::size_t count = 0;
+
+    void release() {
+        if (elements) munmap(elements, bytes());
+        elements = nullptr;
+        count = 0;
+    }
+
+public:
+    ZeroedPages() = default;
+    explicit ZeroedPages(std::size_t n) : count(n) {
+        if (n == 0) return;
+        void* p = mmap(nullptr, n * sizeof(E), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) throw std::bad_alloc();
+        elements = static_cast<E*>(p);
+    }
+    ~ZeroedPages() { release(); }
+
+    ZeroedPages(ZeroedPages&& other) noexcept : elements(other.elements), count(other.count) {
+        other.elements = nullptr;
+        other.count = 0;
+    }
+    ZeroedPages& operator=(ZeroedPages&& other) noexcept {
+        if (this != &other) {
+            release();
+            elements = other.elements;
+            count = other.count;
+            other.elements = nullptr;
+            other.count = 0;
+        }
+        return *this;
+    }
+    ZeroedPages(const ZeroedPages&) = delete;
+    ZeroedPages& operator=(const ZeroedPages&) = delete;
+
+    E* data() { return elements; }
+    const E* data() const { return elements; }
+    E& operator[](std::size_t i) { return elements[i]; }
+    const E& operator[](std::size_t i) const { return elements[i]; }
+    std::size_t size() const { return count; }
+    // Reserved address space; resident memory is only the touched part of it
+    std::size_t bytes() const { return count * sizeof(E); }
+};